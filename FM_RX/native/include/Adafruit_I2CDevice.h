@@ -0,0 +1,2 @@
+// Host build: nothing needed beyond Wire
+#include <Wire.h>
@@ -0,0 +1,65 @@
+// Host-side SSD1306 with a real framebuffer. Text is drawn as solid 5x7 cells,
+// which is enough to see which pixels a render touches.
+#ifndef MOCK_SSD1306_h
+#define MOCK_SSD1306_h
+
+#include <Wire.h>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+#define SSD1306_SETCONTRAST 0x81
+#define SSD1306_DISPLAYOFF 0xAE
+#define SSD1306_DISPLAYON 0xAF
+
+class Adafruit_GFX : public Print {
+    public:
+        Adafruit_GFX(int16_t w, int16_t h);
+        virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+        void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+        void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+        void setCursor(int16_t x, int16_t y) { cursor_x = x; cursor_y = y; }
+        int16_t getCursorX() const { return cursor_x; }
+        int16_t getCursorY() const { return cursor_y; }
+        void setTextSize(uint8_t s) { textsize = s; }
+        void setTextColor(uint16_t c) { textcolor = c; textbgcolor = c; }
+        void setTextColor(uint16_t c, uint16_t bg) { textcolor = c; textbgcolor = bg; }
+        void cp437(bool x = true) { (void)x; }
+        int16_t width() const { return _width; }
+        int16_t height() const { return _height; }
+        size_t write(uint8_t c);
+        using Print::write;
+
+    protected:
+        int16_t _width, _height;
+        int16_t cursor_x, cursor_y;
+        uint16_t textcolor, textbgcolor;
+        uint8_t textsize;
+};
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+    public:
+        Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi = &Wire, int8_t rst_pin = -1,
+                         uint32_t clkDuring = 400000UL, uint32_t clkAfter = 100000UL);
+        ~Adafruit_SSD1306();
+        bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = 0,
+                   bool reset = true, bool periphBegin = true);
+        void display();
+        void clearDisplay();
+        void drawPixel(int16_t x, int16_t y, uint16_t color);
+        void ssd1306_command(uint8_t c);
+        void dim(bool dim);
+        uint8_t *getBuffer() { return buffer; }
+
+    private:
+        TwoWire *wire;
+        uint8_t *buffer;
+        uint8_t i2caddr;
+        uint32_t wireClk, restoreClk;
+};
+
+#endif
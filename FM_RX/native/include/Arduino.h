@@ -0,0 +1,126 @@
+// Host-side stand-in for the Arduino-ESP32 core, only covers what the firmware uses
+#ifndef MOCK_ARDUINO_h
+#define MOCK_ARDUINO_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#ifdef __cplusplus
+#include <algorithm>
+using std::min;
+using std::max;
+#endif
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define IRAM_ATTR
+
+#define LOW    0x0
+#define HIGH   0x1
+
+#define INPUT  0x01
+#define OUTPUT 0x03
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define DEC 10
+#define HEX 16
+
+#define MOCK_NUM_PINS 49
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class Print {
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t *buffer, size_t size);
+        size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+
+        size_t print(const __FlashStringHelper *str) { return write((const char *)str); }
+        size_t print(const char *str) { return write(str); }
+        size_t print(char c) { return write((uint8_t)c); }
+        size_t print(int value, int base = DEC) { return print((long)value, base); }
+        size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+        size_t print(long value, int base = DEC);
+        size_t print(unsigned long value, int base = DEC);
+        size_t print(long long value, int base = DEC);
+        size_t print(unsigned long long value, int base = DEC);
+        size_t print(double value, int digits = 2);
+
+        template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+        template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+        size_t println() { return write("\r\n"); }
+        size_t printf(const char *format, ...);
+};
+
+class HardwareSerial : public Print {
+    public:
+        void begin(unsigned long baud) { (void)baud; }
+        void setTxTimeoutMs(uint32_t timeout) { (void)timeout; }
+        int available();
+        int read();
+        size_t write(uint8_t c);
+        using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+// Virtual clock, advanced by delay() and by simulated bus traffic
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void mockAdvanceMicros(uint32_t us);
+uint64_t mockMicros64();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+bool setCpuFrequencyMhz(uint32_t mhz);
+uint32_t getCpuFrequencyMhz();
+
+// Cycle counter runs off the virtual clock at the configured CPU frequency
+class EspClass {
+    public:
+        uint32_t getCycleCount();
+};
+
+extern EspClass ESP;
+
+// Test hooks: drive inputs and fire the attached interrupt handler
+void mockSetPin(uint8_t pin, int value);
+void mockSetAnalog(uint8_t pin, uint16_t value);
+void mockSerialInput(const char *text);     // Queued for Serial.read(), must outlive the reads
+
+typedef struct hw_timer_s hw_timer_t;
+hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool countUp);
+void timerAttachInterrupt(hw_timer_t *timer, void (*isr)(void), bool edge);
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm_value, bool autoreload);
+void timerAlarmEnable(hw_timer_t *timer);
+void timerAlarmDisable(hw_timer_t *timer);
+
+// Fires any timer alarms that have elapsed on the virtual clock
+void mockServiceTimers();
+
+// Sleeps the main thread on the virtual clock: jumps to the next timer alarm,
+// or max_us ahead if none is due sooner, and fires it
+void mockIdle(uint32_t max_us);
+
+void setup();
+void loop();
+
+#endif
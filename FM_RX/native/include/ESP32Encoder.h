@@ -0,0 +1,29 @@
+// Host-side encoder: counts are set by the test harness
+#ifndef MOCK_ESP32ENCODER_h
+#define MOCK_ESP32ENCODER_h
+
+#include <Arduino.h>
+
+class ESP32Encoder;
+typedef void (*enc_isr_cb_t)(void *);
+
+class ESP32Encoder {
+    public:
+        ESP32Encoder(bool always_interrupt = false, enc_isr_cb_t enc_isr_cb = NULL, void *enc_isr_cb_data = NULL);
+        void attachSingleEdge(int aPintNumber, int bPinNumber);
+        void attachHalfQuad(int aPintNumber, int bPinNumber);
+        int64_t getCount();
+        int64_t clearCount();
+        int64_t setCount(int64_t value);
+
+        // Test hook: move the knob by some detents, firing the ISR callback if enabled
+        void mockTurn(int64_t detents);
+
+    private:
+        int64_t _count;
+        bool _always_interrupt;
+        enc_isr_cb_t _isr_cb;
+        void *_isr_cb_data;
+};
+
+#endif
@@ -0,0 +1,23 @@
+// Host-side Preferences, keys live in memory for the life of the process
+#ifndef MOCK_PREFERENCES_h
+#define MOCK_PREFERENCES_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Preferences {
+    public:
+        Preferences();
+        bool begin( const char *name, bool readOnly = false, const char *partition_label = NULL );
+        void end();
+        size_t putBytes( const char *key, const void *value, size_t len );
+        size_t getBytes( const char *key, void *buf, size_t maxLen );
+        size_t getBytesLength( const char *key );
+        bool remove( const char *key );
+
+    private:
+        bool _open;
+        bool _readOnly;
+};
+
+#endif
@@ -0,0 +1,69 @@
+// Host-side TwoWire that records every transaction against the virtual clock
+#ifndef MOCK_WIRE_h
+#define MOCK_WIRE_h
+
+#include <Arduino.h>
+#include <mutex>
+
+#define I2C_BUFFER_LENGTH 128
+#define MOCK_I2C_LOG_SIZE 4096
+
+struct MockI2CTransaction {
+    uint32_t timestamp;     // Virtual micros() at the start of the transaction
+    uint32_t duration;      // Simulated wire time in microseconds
+    uint8_t addr;
+    uint8_t read;           // 1 for requestFrom, 0 for writes
+    uint8_t nack;
+    uint16_t length;
+    uint8_t data[I2C_BUFFER_LENGTH];
+};
+
+class TwoWire : public Print {
+    public:
+        TwoWire(uint8_t bus_num);
+        bool begin( int sda = -1, int scl = -1, uint32_t frequency = 0 );
+        bool setPins(int sda, int scl);
+        bool setClock(uint32_t frequency);
+        uint32_t getClock() { return _clock; }
+
+        void beginTransmission(uint16_t address);
+        void beginTransmission(int address) { beginTransmission((uint16_t)address); }
+        uint8_t endTransmission(bool sendStop = true);
+        uint8_t requestFrom(uint16_t address, uint8_t size, bool sendStop = true);
+        uint8_t requestFrom(int address, int size) { return requestFrom((uint16_t)address, (uint8_t)size, true); }
+
+        size_t write(uint8_t data);
+        size_t write(const uint8_t *data, size_t size);
+        int available();
+        int read();
+
+        // Log access
+        uint32_t transactionCount() { return _logCount; }
+        const MockI2CTransaction *transaction(uint32_t index);
+        void clearLog() { _logCount = 0; }
+        uint32_t bytesTo(uint8_t addr);
+
+        // Addresses that NACK, and data returned by reads (per address)
+        void mockSetPresent(uint8_t addr, bool present);
+        void mockSetReadData(uint8_t addr, const uint8_t *data, uint8_t length);
+
+    private:
+        MockI2CTransaction *logTransaction(uint8_t addr, uint8_t read, const uint8_t *data, uint16_t length);
+
+        uint32_t _clock;
+        uint16_t _txAddr;
+        uint16_t _txLength;
+        uint8_t _txBuffer[I2C_BUFFER_LENGTH];
+        uint8_t _rxBuffer[I2C_BUFFER_LENGTH];
+        uint8_t _rxLength;
+        uint8_t _rxIndex;
+        uint8_t _absent[128];
+        uint8_t _readData[128][4];
+        std::recursive_mutex _lock;     // Held from beginTransmission to endTransmission, like the ESP32 core
+        MockI2CTransaction _log[MOCK_I2C_LOG_SIZE];
+        uint32_t _logCount;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1 @@
+// Host build: LEDC is not used
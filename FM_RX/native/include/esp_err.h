@@ -0,0 +1,12 @@
+// Host-side ESP-IDF error codes
+#ifndef MOCK_ESP_ERR_h
+#define MOCK_ESP_ERR_h
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_NOT_SUPPORTED 0x106
+
+#endif
@@ -0,0 +1,16 @@
+// Host-side ESP-IDF 4.4 power management, configuration is only recorded
+#ifndef MOCK_ESP_PM_h
+#define MOCK_ESP_PM_h
+
+#include <stdbool.h>
+#include <esp_err.h>
+
+typedef struct {
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_esp32s3_t;
+
+esp_err_t esp_pm_configure(const void *config);
+
+#endif
@@ -0,0 +1,10 @@
+// Host-side ESP-IDF 4.4 sleep API, light sleep returns immediately
+#ifndef MOCK_ESP_SLEEP_h
+#define MOCK_ESP_SLEEP_h
+
+#include <esp_err.h>
+
+esp_err_t esp_sleep_enable_gpio_wakeup();
+esp_err_t esp_light_sleep_start();
+
+#endif
@@ -0,0 +1,42 @@
+// Host-side FreeRTOS subset: tasks are std::threads, ticks are milliseconds
+#ifndef MOCK_FREERTOS_h
+#define MOCK_FREERTOS_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+
+#ifndef portMAX_DELAY
+#define portMAX_DELAY 0xFFFFFFFF
+// Core the calling task is pinned to, the Arduino loop() thread reports core 1
+BaseType_t xPortGetCoreID();
+
+#endif
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define portYIELD_FROM_ISR(x) ((void)(x))
+
+// Critical sections map onto one global host mutex
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portMUX_INITIALIZE(mux) ((mux)->unused = 0)
+void mockEnterCritical();
+void mockExitCritical();
+#define portENTER_CRITICAL(mux) ((void)(mux), mockEnterCritical())
+#define portEXIT_CRITICAL(mux) ((void)(mux), mockExitCritical())
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+
+// Core the calling task is pinned to, the Arduino loop() thread reports core 1
+BaseType_t xPortGetCoreID();
+
+#endif
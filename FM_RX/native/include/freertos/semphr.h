@@ -0,0 +1,12 @@
+#ifndef MOCK_FREERTOS_SEMPHR_h
+#define MOCK_FREERTOS_SEMPHR_h
+
+#include <freertos/FreeRTOS.h>
+
+typedef struct MockSemaphore *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+#endif
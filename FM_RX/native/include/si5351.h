@@ -0,0 +1,69 @@
+// Host-side Si5351 with the Etherkit API surface the firmware uses. Register
+// traffic goes out through the mock Wire so it shows up in the transaction log.
+#ifndef MOCK_SI5351_h
+#define MOCK_SI5351_h
+
+#include <Wire.h>
+
+#define SI5351_BUS_BASE_ADDR        0x60
+#define SI5351_XTAL_FREQ            25000000
+#define SI5351_PLL_FIXED            80000000000ULL
+#define SI5351_FREQ_MULT            100ULL
+#define SI5351_PLL_VCO_MIN          600000000
+#define SI5351_PLL_VCO_MAX          900000000
+#define SI5351_PLL_C_MAX            1048575
+#define SI5351_CRYSTAL_LOAD_10PF    (3 << 6)
+
+#define SI5351_PLLA_PARAMETERS      26
+#define SI5351_PLLB_PARAMETERS      34
+#define SI5351_CLK0_PARAMETERS      42
+
+enum si5351_clock { SI5351_CLK0, SI5351_CLK1, SI5351_CLK2, SI5351_CLK3,
+    SI5351_CLK4, SI5351_CLK5, SI5351_CLK6, SI5351_CLK7 };
+enum si5351_pll { SI5351_PLLA, SI5351_PLLB };
+enum si5351_drive { SI5351_DRIVE_2MA, SI5351_DRIVE_4MA, SI5351_DRIVE_6MA, SI5351_DRIVE_8MA };
+enum si5351_pll_input { SI5351_PLL_INPUT_XO, SI5351_PLL_INPUT_CLKIN };
+
+struct Si5351RegSet {
+    uint32_t p1;
+    uint32_t p2;
+    uint32_t p3;
+};
+
+struct Si5351Status {
+    uint8_t SYS_INIT;
+    uint8_t LOL_B;
+    uint8_t LOL_A;
+    uint8_t LOS;
+    uint8_t REVID;
+};
+
+class Si5351 {
+    public:
+        Si5351(uint8_t i2c_addr = SI5351_BUS_BASE_ADDR);
+        bool init(uint8_t xtal_load_c, uint32_t xo_freq, int32_t corr);
+        uint8_t set_freq(uint64_t freq, enum si5351_clock clk);
+        uint8_t set_freq_manual(uint64_t freq, uint64_t pll_freq, enum si5351_clock clk);
+        void set_pll(uint64_t pll_freq, enum si5351_pll target_pll);
+        void output_enable(enum si5351_clock clk, uint8_t enable);
+        void drive_strength(enum si5351_clock clk, enum si5351_drive drive);
+        void update_status();
+        void set_correction(int32_t corr, enum si5351_pll_input ref_osc);
+        int32_t get_correction(enum si5351_pll_input ref_osc);
+        void pll_reset(enum si5351_pll target_pll);
+        uint8_t si5351_write_bulk(uint8_t addr, uint8_t bytes, uint8_t *data);
+        uint8_t si5351_write(uint8_t addr, uint8_t data);
+        uint8_t si5351_read(uint8_t addr);
+
+        struct Si5351Status dev_status;
+        uint64_t clk_freq[8];
+        uint64_t plla_freq;
+        uint64_t pllb_freq;
+        uint32_t xtal_freq[2];
+
+    private:
+        int32_t ref_correction[2];
+        uint8_t i2c_bus_addr;
+};
+
+#endif
@@ -0,0 +1,90 @@
+// Entry point for the native env: runs the firmware's setup()/loop() against
+// the mocks, turns the knobs a little and dumps what went out on the buses
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <ESP32Encoder.h>
+#include <driver/i2s.h>
+#include <i2c_profiler.h>
+
+// The test runner brings its own main()
+#ifndef PIO_UNIT_TESTING
+
+#ifndef HOST_LOOP_PASSES
+#define HOST_LOOP_PASSES 20
+#endif
+
+extern ESP32Encoder rot1, rot2;
+void runBenchmark();
+
+static void runPasses(uint32_t passes)
+{
+    for (uint32_t i = 0; i < passes; i++)
+    {
+        delay(10);
+        loop();
+    }
+}
+
+static void dumpBusLog(uint32_t first)
+{
+    for (uint32_t i = first; i < Wire.transactionCount(); i++)
+    {
+        const MockI2CTransaction *t = Wire.transaction(i);
+        printf("%10u us  0x%02X %c %3u bytes %4u us %s\n", t->timestamp, t->addr,
+               t->read ? 'R' : 'W', t->length, t->duration, t->nack ? "NACK" : "");
+    }
+}
+
+static void dumpSummary()
+{
+    static const uint8_t addrs[] = { 0x1A, 0x3C, 0x60 };
+    for (uint8_t a = 0; a < sizeof(addrs); a++)
+    {
+        uint32_t transactions = 0, us = 0;
+        for (uint32_t i = 0; i < Wire.transactionCount(); i++)
+        {
+            const MockI2CTransaction *t = Wire.transaction(i);
+            if (t->addr == addrs[a])
+            {
+                transactions++;
+                us += t->duration;
+            }
+        }
+        printf("0x%02X: %5u transactions %6u bytes %7u us\n", addrs[a], transactions, Wire.bytesTo(addrs[a]), us);
+    }
+    printf("I2S driver calls: %u\n", mockI2SCallCount());
+    i2c_profiler.dump(&Serial);
+}
+
+int main()
+{
+    setup();
+
+#ifdef HOST_BENCHMARK
+    // Latency here is simulated bus time, CPU work on the host doesn't count
+    runBenchmark();
+    i2c_profiler.dump(&Serial);
+    return 0;
+#endif
+
+    runPasses(HOST_LOOP_PASSES);
+    vTaskDelay(50);     // Let the display task drain
+
+    uint32_t mark = Wire.transactionCount();
+    printf("-- setup + idle: %u transactions\n", mark);
+
+    rot1.mockTurn(3);   // Tune up three steps
+    runPasses(1);
+    rot2.mockTurn(-2);  // Volume down two
+    runPasses(1);
+    vTaskDelay(50);
+
+    printf("-- tune + volume\n");
+    dumpBusLog(mark);
+    printf("-- totals\n");
+    dumpSummary();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,412 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static std::atomic<uint64_t> mock_us(0);  // Shared with mock task threads
+
+static uint8_t pin_mode[MOCK_NUM_PINS];
+static uint8_t pin_level[MOCK_NUM_PINS];
+static uint16_t pin_analog[MOCK_NUM_PINS];
+static void (*pin_isr[MOCK_NUM_PINS])(void);
+static int pin_isr_mode[MOCK_NUM_PINS];
+
+struct hw_timer_s {
+    uint16_t divider;
+    uint64_t alarm;
+    bool autoreload;
+    bool enabled;
+    uint64_t next_fire;
+    void (*isr)(void);
+};
+
+static hw_timer_s timers[4];
+
+#define MOCK_NUM_ESP_TIMERS 4
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    uint64_t period;
+    bool running;
+    uint64_t next_fire;
+};
+
+static esp_timer esp_timers[MOCK_NUM_ESP_TIMERS];
+static uint8_t num_esp_timers = 0;
+
+
+// Print
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+    {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+static size_t printNumber(Print *p, unsigned long long value, int base, bool negative)
+{
+    char buf[72];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2)
+    {
+        base = 10;
+    }
+    do
+    {
+        char c = value % base;
+        value /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (value);
+    if (negative)
+    {
+        *--str = '-';
+    }
+    return p->write(str);
+}
+
+size_t Print::print(long value, int base)
+{
+    if (base == DEC && value < 0)
+    {
+        return printNumber(this, (unsigned long long)(-(long long)value), base, true);
+    }
+    return printNumber(this, (unsigned long)value, base, false);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+    return printNumber(this, value, base, false);
+}
+
+size_t Print::print(long long value, int base)
+{
+    if (base == DEC && value < 0)
+    {
+        return printNumber(this, (unsigned long long)(-value), base, true);
+    }
+    return printNumber(this, (unsigned long long)value, base, false);
+}
+
+size_t Print::print(unsigned long long value, int base)
+{
+    return printNumber(this, value, base, false);
+}
+
+size_t Print::print(double value, int digits)
+{
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, value);
+    return write(buf);
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return write(buf);
+}
+
+
+// Serial goes to stdout, input comes from mockSerialInput()
+
+static const char *serial_input = "";
+
+void mockSerialInput(const char *text)
+{
+    serial_input = text;
+}
+
+int HardwareSerial::available()
+{
+    return strlen(serial_input);
+}
+
+int HardwareSerial::read()
+{
+    return *serial_input ? *serial_input++ : -1;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+
+// Virtual clock
+
+uint32_t millis()
+{
+    return (uint32_t)(mock_us / 1000);
+}
+
+uint32_t micros()
+{
+    return (uint32_t)mock_us;
+}
+
+uint64_t mockMicros64()
+{
+    return mock_us;
+}
+
+void mockAdvanceMicros(uint32_t us)
+{
+    mock_us += us;
+}
+
+void delay(uint32_t ms)
+{
+    mock_us += (uint64_t)ms * 1000;
+    mockServiceTimers();
+    // Give mock tasks (display flush etc.) a real-time slot to run in
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    mock_us += us;
+}
+
+static uint32_t cpu_mhz = 240;
+
+bool setCpuFrequencyMhz(uint32_t mhz)
+{
+    cpu_mhz = mhz;
+    return true;
+}
+
+uint32_t getCpuFrequencyMhz()
+{
+    return cpu_mhz;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    return (uint32_t)(mock_us * cpu_mhz);
+}
+
+
+// GPIO
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin < MOCK_NUM_PINS)
+    {
+        pin_mode[pin] = mode;
+        if (mode == INPUT && !pin_level[pin])
+        {
+            pin_level[pin] = HIGH; // Board has pull-ups on every input we use
+        }
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin < MOCK_NUM_PINS)
+    {
+        pin_level[pin] = value ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    return pin < MOCK_NUM_PINS ? pin_level[pin] : LOW;
+}
+
+uint16_t analogRead(uint8_t pin)
+{
+    return pin < MOCK_NUM_PINS ? pin_analog[pin] : 0;
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin)
+{
+    return (uint32_t)analogRead(pin) * 3300 / 4095;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode)
+{
+    if (pin < MOCK_NUM_PINS)
+    {
+        pin_isr[pin] = isr;
+        pin_isr_mode[pin] = mode;
+    }
+}
+
+void mockSetPin(uint8_t pin, int value)
+{
+    if (pin >= MOCK_NUM_PINS)
+    {
+        return;
+    }
+    uint8_t prev = pin_level[pin];
+    pin_level[pin] = value ? HIGH : LOW;
+    if (pin_isr[pin] && prev != pin_level[pin])
+    {
+        int mode = pin_isr_mode[pin];
+        if (mode == CHANGE || (mode == RISING && value) || (mode == FALLING && !value))
+        {
+            pin_isr[pin]();
+        }
+    }
+}
+
+void mockSetAnalog(uint8_t pin, uint16_t value)
+{
+    if (pin < MOCK_NUM_PINS)
+    {
+        pin_analog[pin] = value;
+    }
+}
+
+
+// Hardware timers, divider is relative to the 80 MHz APB clock
+
+hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool countUp)
+{
+    (void)countUp;
+    if (num >= 4)
+    {
+        return NULL;
+    }
+    timers[num].divider = divider;
+    return &timers[num];
+}
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*isr)(void), bool edge)
+{
+    (void)edge;
+    timer->isr = isr;
+}
+
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm_value, bool autoreload)
+{
+    timer->alarm = alarm_value;
+    timer->autoreload = autoreload;
+}
+
+void timerAlarmEnable(hw_timer_t *timer)
+{
+    timer->enabled = true;
+    timer->next_fire = mock_us + timer->alarm * timer->divider / 80;
+}
+
+void timerAlarmDisable(hw_timer_t *timer)
+{
+    timer->enabled = false;
+}
+
+// esp_timer, microseconds on the same virtual clock
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle || num_esp_timers >= MOCK_NUM_ESP_TIMERS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_timer *t = &esp_timers[num_esp_timers++];
+    t->callback = create_args->callback;
+    t->arg = create_args->arg;
+    t->running = false;
+    *out_handle = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (!timer)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period = period;
+    timer->next_fire = mock_us + period;
+    timer->running = period != 0;
+    return period ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!timer->running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->running = false;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time()
+{
+    return (int64_t)mock_us;
+}
+
+void mockServiceTimers()
+{
+    for (uint8_t i = 0; i < num_esp_timers; i++)
+    {
+        esp_timer *t = &esp_timers[i];
+        while (t->running && mock_us >= t->next_fire)
+        {
+            t->callback(t->arg);
+            t->next_fire += t->period;
+        }
+    }
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        hw_timer_s *t = &timers[i];
+        uint64_t period = t->alarm * t->divider / 80;
+        while (t->enabled && t->isr && period && mock_us >= t->next_fire)
+        {
+            t->isr();
+            if (!t->autoreload)
+            {
+                t->enabled = false;
+            }
+            t->next_fire += period;
+        }
+    }
+}
+
+void mockIdle(uint32_t max_us)
+{
+    uint64_t now = mock_us;
+    uint64_t wake = now + max_us;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        hw_timer_s *t = &timers[i];
+        if (t->enabled && t->isr && t->next_fire < wake)
+        {
+            wake = t->next_fire > now ? t->next_fire : now;
+        }
+    }
+    for (uint8_t i = 0; i < num_esp_timers; i++)
+    {
+        esp_timer *t = &esp_timers[i];
+        if (t->running && t->next_fire < wake)
+        {
+            wake = t->next_fire > now ? t->next_fire : now;
+        }
+    }
+    mock_us = wake;
+    mockServiceTimers();
+}
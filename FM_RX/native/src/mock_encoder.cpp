@@ -0,0 +1,47 @@
+#include <ESP32Encoder.h>
+
+ESP32Encoder::ESP32Encoder(bool always_interrupt, enc_isr_cb_t enc_isr_cb, void *enc_isr_cb_data)
+{
+    _count = 0;
+    _always_interrupt = always_interrupt;
+    _isr_cb = enc_isr_cb;
+    _isr_cb_data = enc_isr_cb_data;
+}
+
+void ESP32Encoder::attachSingleEdge(int aPintNumber, int bPinNumber)
+{
+    (void)aPintNumber;
+    (void)bPinNumber;
+}
+
+void ESP32Encoder::attachHalfQuad(int aPintNumber, int bPinNumber)
+{
+    (void)aPintNumber;
+    (void)bPinNumber;
+}
+
+int64_t ESP32Encoder::getCount()
+{
+    return _count;
+}
+
+int64_t ESP32Encoder::clearCount()
+{
+    _count = 0;
+    return 0;
+}
+
+int64_t ESP32Encoder::setCount(int64_t value)
+{
+    _count = value;
+    return _count;
+}
+
+void ESP32Encoder::mockTurn(int64_t detents)
+{
+    _count += detents;
+    if (_always_interrupt && _isr_cb)
+    {
+        _isr_cb(_isr_cb_data ? _isr_cb_data : this);
+    }
+}
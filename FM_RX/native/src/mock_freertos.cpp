@@ -0,0 +1,195 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Task delays and timeouts run on the host's real clock, the virtual
+// micros() clock is only advanced by the main thread and bus traffic
+
+struct MockTask {
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notify;
+};
+
+struct MockSemaphore {
+    std::timed_mutex lock;
+};
+
+static thread_local MockTask *current_task = NULL;
+static thread_local BaseType_t current_core = 1;
+static std::recursive_mutex critical;
+static std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+void mockEnterCritical()
+{
+    critical.lock();
+}
+
+void mockExitCritical()
+{
+    critical.unlock();
+}
+
+struct TaskStart {
+    TaskFunction_t fn;
+    void *param;
+    MockTask *task;
+    BaseType_t core;
+};
+
+BaseType_t xPortGetCoreID()
+{
+    return current_core;
+}
+
+struct MockTaskExit {};
+
+static void taskEntry(TaskStart start)
+{
+    current_task = start.task;
+    current_core = start.core;
+    try
+    {
+        start.fn(start.param);
+    }
+    catch (MockTaskExit &)
+    {
+    }
+}
+
+// Unwinds the calling task's thread back to taskEntry()
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task || task == current_task)
+    {
+        throw MockTaskExit();
+    }
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *param, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+    MockTask *task = new MockTask();
+    task->notify = 0;
+    if (handle)
+    {
+        *handle = task;
+    }
+    TaskStart start = { fn, param, task, core };
+    std::thread(taskEntry, start).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *param, UBaseType_t priority, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, param, priority, handle, 0);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    if (!current_task)
+    {
+        current_task = new MockTask();
+        current_task->notify = 0;
+    }
+    return current_task;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    MockTask *task = xTaskGetCurrentTaskHandle();
+    if (current_core == 1 && ticks_to_wait && ticks_to_wait != portMAX_DELAY)
+    {
+        // loop() blocking on its event queue: only timer ISRs can wake it on
+        // the host, so move the virtual clock on to the next one
+        bool pending;
+        {
+            std::lock_guard<std::mutex> guard(task->lock);
+            pending = task->notify != 0;
+        }
+        if (!pending)
+        {
+            mockIdle(ticks_to_wait * 1000);
+        }
+    }
+    std::unique_lock<std::mutex> guard(task->lock);
+    if (ticks_to_wait == portMAX_DELAY)
+    {
+        task->cv.wait(guard, [task] { return task->notify != 0; });
+    }
+    else
+    {
+        task->cv.wait_for(guard, std::chrono::milliseconds(ticks_to_wait), [task] { return task->notify != 0; });
+    }
+    uint32_t value = task->notify;
+    if (value)
+    {
+        task->notify = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notify++;
+    }
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken)
+{
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken)
+    {
+        *higher_priority_task_woken = pdTRUE;
+    }
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return new MockSemaphore();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    if (ticks_to_wait == portMAX_DELAY)
+    {
+        sem->lock.lock();
+        return pdTRUE;
+    }
+    if (ticks_to_wait == 0)
+    {
+        return sem->lock.try_lock() ? pdTRUE : pdFALSE;
+    }
+    return sem->lock.try_lock_for(std::chrono::milliseconds(ticks_to_wait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    sem->lock.unlock();
+    return pdTRUE;
+}
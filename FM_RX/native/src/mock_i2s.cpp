@@ -0,0 +1,119 @@
+#include <Arduino.h>
+#include <driver/i2s.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+// No audio on the host: reads return silence paced in real time at the
+// configured sample rate, writes are discarded
+
+static i2s_config_t config[I2S_NUM_MAX];
+static bool installed[I2S_NUM_MAX];
+static std::atomic<uint32_t> calls(0);     // Audio task logs from its own thread
+static MockI2SCall call_log[MOCK_I2S_LOG_SIZE];
+
+static void logCall(const char *call, i2s_port_t port, uint32_t bytes)
+{
+    uint32_t index = calls++;
+    if (index < MOCK_I2S_LOG_SIZE)
+    {
+        call_log[index].timestamp = micros();
+        call_log[index].call = call;
+        call_log[index].port = port;
+        call_log[index].bytes = bytes;
+    }
+}
+
+esp_err_t i2s_driver_install(i2s_port_t i2s_num, const i2s_config_t *i2s_config, int queue_size, void *i2s_queue)
+{
+    (void)queue_size;
+    (void)i2s_queue;
+    logCall("i2s_driver_install", i2s_num, 0);
+    if (installed[i2s_num])
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    config[i2s_num] = *i2s_config;
+    installed[i2s_num] = true;
+    return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t i2s_num)
+{
+    logCall("i2s_driver_uninstall", i2s_num, 0);
+    installed[i2s_num] = false;
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t i2s_num, const i2s_pin_config_t *pin)
+{
+    (void)pin;
+    logCall("i2s_set_pin", i2s_num, 0);
+    return installed[i2s_num] ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_start(i2s_port_t i2s_num)
+{
+    logCall("i2s_start", i2s_num, 0);
+    return installed[i2s_num] ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_stop(i2s_port_t i2s_num)
+{
+    logCall("i2s_stop", i2s_num, 0);
+    return installed[i2s_num] ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t i2s_num)
+{
+    logCall("i2s_zero_dma_buffer", i2s_num, 0);
+    return installed[i2s_num] ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_set_clk(i2s_port_t i2s_num, uint32_t rate, uint32_t bits_cfg, i2s_channel_t ch)
+{
+    (void)ch;
+    logCall("i2s_set_clk", i2s_num, 0);
+    config[i2s_num].sample_rate = rate;
+    config[i2s_num].bits_per_sample = (i2s_bits_per_sample_t)(bits_cfg & 0xFFFF);
+    return installed[i2s_num] ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_read(i2s_port_t i2s_num, void *dest, size_t size, size_t *bytes_read, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    logCall("i2s_read", i2s_num, size);
+    if (installed[i2s_num] && config[i2s_num].sample_rate)
+    {   // Real time, like the DMA filling up, so a reader task doesn't spin
+        uint32_t frame_bytes = config[i2s_num].bits_per_sample > 16 ? 4 : 2;
+        std::this_thread::sleep_for(std::chrono::microseconds(
+            (uint64_t)size * 1000000 / (config[i2s_num].sample_rate * frame_bytes)));
+    }
+    memset(dest, 0, size);
+    *bytes_read = installed[i2s_num] ? size : 0;
+    return installed[i2s_num] ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_write(i2s_port_t i2s_num, const void *src, size_t size, size_t *bytes_written, TickType_t ticks_to_wait)
+{
+    (void)src;
+    (void)ticks_to_wait;
+    logCall("i2s_write", i2s_num, size);
+    *bytes_written = installed[i2s_num] ? size : 0;
+    return installed[i2s_num] ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+const i2s_config_t *mockI2SConfig(i2s_port_t i2s_num)
+{
+    return &config[i2s_num];
+}
+
+uint32_t mockI2SCallCount()
+{
+    return calls;
+}
+
+const MockI2SCall *mockI2SCall(uint32_t index)
+{
+    return index < calls && index < MOCK_I2S_LOG_SIZE ? &call_log[index] : NULL;
+}
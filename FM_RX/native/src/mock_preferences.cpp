@@ -0,0 +1,59 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// One flat namespace is enough for the host, every write is logged so
+// coalescing can be checked against the loop timeline
+static std::map<std::string, std::vector<uint8_t> > nvs;
+
+Preferences::Preferences()
+{
+    _open = false;
+    _readOnly = false;
+}
+
+bool Preferences::begin(const char *, bool readOnly, const char *)
+{
+    _open = true;
+    _readOnly = readOnly;
+    return true;
+}
+
+void Preferences::end()
+{
+    _open = false;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len)
+{
+    if (!_open || _readOnly || !key || !value) {
+        return 0;
+    }
+    const uint8_t *bytes = (const uint8_t *)value;
+    nvs[key].assign(bytes, bytes + len);
+    printf("%10u us  nvs write %s (%u bytes)\n", micros(), key, (unsigned)len);
+    return len;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen)
+{
+    std::map<std::string, std::vector<uint8_t> >::iterator it = nvs.find(key);
+    if (!_open || it == nvs.end() || it->second.size() > maxLen) {
+        return 0;
+    }
+    memcpy(buf, &it->second[0], it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+    std::map<std::string, std::vector<uint8_t> >::iterator it = nvs.find(key);
+    return _open && it != nvs.end() ? it->second.size() : 0;
+}
+
+bool Preferences::remove(const char *key)
+{
+    return _open && !_readOnly && nvs.erase(key);
+}
@@ -0,0 +1,141 @@
+#include <si5351.h>
+
+// Roughly the same register traffic as the Etherkit driver: parameter blocks
+// go out as one bulk write, control bits as read-modify-write
+
+Si5351::Si5351(uint8_t i2c_addr)
+{
+    i2c_bus_addr = i2c_addr;
+    memset(&dev_status, 0, sizeof(dev_status));
+    memset(clk_freq, 0, sizeof(clk_freq));
+    plla_freq = SI5351_PLL_FIXED;
+    pllb_freq = SI5351_PLL_FIXED;
+    xtal_freq[0] = SI5351_XTAL_FREQ;
+    xtal_freq[1] = SI5351_XTAL_FREQ;
+    ref_correction[0] = 0;
+    ref_correction[1] = 0;
+}
+
+bool Si5351::init(uint8_t xtal_load_c, uint32_t xo_freq, int32_t corr)
+{
+    Wire.begin();
+    Wire.beginTransmission(i2c_bus_addr);
+    if (Wire.endTransmission() != 0)
+    {
+        return false;
+    }
+    if (xo_freq)
+    {
+        xtal_freq[0] = xo_freq;
+    }
+    ref_correction[0] = corr;
+    si5351_write(3, 0xFF);          // Disable outputs
+    si5351_write(183, xtal_load_c);
+    set_pll(SI5351_PLL_FIXED, SI5351_PLLA);
+    set_pll(SI5351_PLL_FIXED, SI5351_PLLB);
+    si5351_write(177, 0xA0);        // Reset both PLLs
+    return true;
+}
+
+uint8_t Si5351::set_freq(uint64_t freq, enum si5351_clock clk)
+{
+    uint8_t params[8] = {0};
+    clk_freq[clk] = freq;
+    params[0] = (uint8_t)(plla_freq / freq);
+    si5351_write_bulk(SI5351_CLK0_PARAMETERS + 8 * clk, 8, params);
+    si5351_write(16 + clk, 0x4C);
+    return 0;
+}
+
+uint8_t Si5351::set_freq_manual(uint64_t freq, uint64_t pll_freq, enum si5351_clock clk)
+{
+    set_pll(pll_freq, SI5351_PLLA);
+    return set_freq(freq, clk);
+}
+
+void Si5351::set_pll(uint64_t pll_freq, enum si5351_pll target_pll)
+{
+    uint8_t params[8] = {0};
+    if (target_pll == SI5351_PLLA)
+    {
+        plla_freq = pll_freq;
+    }
+    else
+    {
+        pllb_freq = pll_freq;
+    }
+    si5351_write_bulk(target_pll == SI5351_PLLA ? SI5351_PLLA_PARAMETERS : SI5351_PLLB_PARAMETERS, 8, params);
+}
+
+void Si5351::output_enable(enum si5351_clock clk, uint8_t enable)
+{
+    uint8_t reg_val = si5351_read(3);
+    if (enable)
+    {
+        reg_val &= ~(1 << (uint8_t)clk);
+    }
+    else
+    {
+        reg_val |= (1 << (uint8_t)clk);
+    }
+    si5351_write(3, reg_val);
+}
+
+void Si5351::drive_strength(enum si5351_clock clk, enum si5351_drive drive)
+{
+    uint8_t reg_val = si5351_read(16 + (uint8_t)clk);
+    si5351_write(16 + (uint8_t)clk, (reg_val & ~0x03) | (uint8_t)drive);
+}
+
+void Si5351::update_status()
+{
+    uint8_t reg_val = si5351_read(0);
+    dev_status.SYS_INIT = (reg_val >> 7) & 0x01;
+    dev_status.LOL_B = (reg_val >> 6) & 0x01;
+    dev_status.LOL_A = (reg_val >> 5) & 0x01;
+    dev_status.LOS = (reg_val >> 4) & 0x01;
+    dev_status.REVID = reg_val & 0x03;
+}
+
+void Si5351::set_correction(int32_t corr, enum si5351_pll_input ref_osc)
+{
+    ref_correction[(uint8_t)ref_osc] = corr;
+    set_pll(plla_freq, SI5351_PLLA);
+    set_pll(pllb_freq, SI5351_PLLB);
+}
+
+int32_t Si5351::get_correction(enum si5351_pll_input ref_osc)
+{
+    return ref_correction[(uint8_t)ref_osc];
+}
+
+void Si5351::pll_reset(enum si5351_pll target_pll)
+{
+    si5351_write(177, target_pll == SI5351_PLLA ? 0x20 : 0x80);
+}
+
+uint8_t Si5351::si5351_write_bulk(uint8_t addr, uint8_t bytes, uint8_t *data)
+{
+    Wire.beginTransmission(i2c_bus_addr);
+    Wire.write(addr);
+    Wire.write(data, bytes);
+    return Wire.endTransmission();
+}
+
+uint8_t Si5351::si5351_write(uint8_t addr, uint8_t data)
+{
+    Wire.beginTransmission(i2c_bus_addr);
+    Wire.write(addr);
+    Wire.write(data);
+    return Wire.endTransmission();
+}
+
+uint8_t Si5351::si5351_read(uint8_t addr)
+{
+    Wire.beginTransmission(i2c_bus_addr);
+    Wire.write(addr);
+    Wire.endTransmission();
+    Wire.requestFrom(i2c_bus_addr, (uint8_t)1, false);
+    int reg_val = Wire.read();
+    return reg_val < 0 ? 0 : (uint8_t)reg_val;
+}
@@ -0,0 +1,167 @@
+#include <Adafruit_SSD1306.h>
+#include <stdlib.h>
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h)
+{
+    _width = w;
+    _height = h;
+    cursor_x = 0;
+    cursor_y = 0;
+    textcolor = SSD1306_WHITE;
+    textbgcolor = SSD1306_WHITE;
+    textsize = 1;
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    for (int16_t i = x; i < x + w; i++)
+    {
+        for (int16_t j = y; j < y + h; j++)
+        {
+            drawPixel(i, j, color);
+        }
+    }
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    fillRect(x, y, w, 1, color);
+    fillRect(x, y + h - 1, w, 1, color);
+    fillRect(x, y, 1, h, color);
+    fillRect(x + w - 1, y, 1, h, color);
+}
+
+size_t Adafruit_GFX::write(uint8_t c)
+{
+    // Classic 6x8 cell: glyph in the 5x7 corner, background fills the rest
+    // when it differs from the foreground (same rule as the real GFX font)
+    if (c == '\n')
+    {
+        cursor_x = 0;
+        cursor_y += 8 * textsize;
+        return 1;
+    }
+    if (textbgcolor != textcolor)
+    {
+        fillRect(cursor_x, cursor_y, 6 * textsize, 8 * textsize, textbgcolor);
+    }
+    if (c != ' ')
+    {
+        fillRect(cursor_x, cursor_y, 5 * textsize, 7 * textsize, textcolor);
+    }
+    cursor_x += 6 * textsize;
+    return 1;
+}
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst_pin,
+                                   uint32_t clkDuring, uint32_t clkAfter)
+    : Adafruit_GFX(w, h)
+{
+    (void)rst_pin;
+    wire = twi;
+    buffer = NULL;
+    i2caddr = 0;
+    wireClk = clkDuring;
+    restoreClk = clkAfter;
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306()
+{
+    free(buffer);
+}
+
+bool Adafruit_SSD1306::begin(uint8_t switchvcc, uint8_t addr, bool reset, bool periphBegin)
+{
+    (void)switchvcc;
+    (void)reset;
+    if (!buffer && !(buffer = (uint8_t *)malloc(_width * ((_height + 7) / 8))))
+    {
+        return false;
+    }
+    clearDisplay();
+    i2caddr = addr ? addr : 0x3C;
+    if (periphBegin)
+    {
+        wire->begin();
+    }
+    wire->setClock(wireClk);
+    wire->beginTransmission(i2caddr);
+    wire->write((uint8_t)0x00);
+    for (uint8_t i = 0; i < 25; i++)
+    {
+        wire->write((uint8_t)0xA8); // Stand-in for the init command list
+    }
+    uint8_t err = wire->endTransmission();
+    wire->setClock(restoreClk);
+    return err == 0;
+}
+
+void Adafruit_SSD1306::display()
+{
+    uint16_t count = _width * ((_height + 7) / 8);
+    uint8_t *ptr = buffer;
+    wire->setClock(wireClk);
+    wire->beginTransmission(i2caddr);
+    wire->write((uint8_t)0x00);
+    wire->write((uint8_t)SSD1306_PAGEADDR);
+    wire->write((uint8_t)0);
+    wire->write((uint8_t)0xFF);
+    wire->write((uint8_t)SSD1306_COLUMNADDR);
+    wire->write((uint8_t)0);
+    wire->write((uint8_t)(_width - 1));
+    wire->endTransmission();
+    while (count)
+    {
+        uint16_t chunk = count > I2C_BUFFER_LENGTH - 1 ? I2C_BUFFER_LENGTH - 1 : count;
+        wire->beginTransmission(i2caddr);
+        wire->write((uint8_t)0x40);
+        wire->write(ptr, chunk);
+        wire->endTransmission();
+        ptr += chunk;
+        count -= chunk;
+    }
+    wire->setClock(restoreClk);
+}
+
+void Adafruit_SSD1306::clearDisplay()
+{
+    memset(buffer, 0, _width * ((_height + 7) / 8));
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+    if (x < 0 || y < 0 || x >= _width || y >= _height)
+    {
+        return;
+    }
+    uint8_t *b = &buffer[x + (y / 8) * _width];
+    uint8_t bit = 1 << (y & 7);
+    switch (color)
+    {
+    case SSD1306_WHITE:
+        *b |= bit;
+        break;
+    case SSD1306_BLACK:
+        *b &= ~bit;
+        break;
+    case SSD1306_INVERSE:
+        *b ^= bit;
+        break;
+    }
+}
+
+void Adafruit_SSD1306::ssd1306_command(uint8_t c)
+{
+    wire->setClock(wireClk);
+    wire->beginTransmission(i2caddr);
+    wire->write((uint8_t)0x00);
+    wire->write(c);
+    wire->endTransmission();
+    wire->setClock(restoreClk);
+}
+
+void Adafruit_SSD1306::dim(bool dim)
+{
+    ssd1306_command(0x81);
+    ssd1306_command(dim ? 0 : 0xCF);
+}
@@ -0,0 +1,158 @@
+#include <Wire.h>
+
+TwoWire Wire(0);
+
+TwoWire::TwoWire(uint8_t bus_num)
+{
+    (void)bus_num;
+    _clock = 100000;
+    _txAddr = 0;
+    _txLength = 0;
+    _rxLength = 0;
+    _rxIndex = 0;
+    _logCount = 0;
+    memset(_absent, 0, sizeof(_absent));
+    memset(_readData, 0, sizeof(_readData));
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency)
+{
+    (void)sda;
+    (void)scl;
+    if (frequency)
+    {
+        setClock(frequency);
+    }
+    return true;
+}
+
+bool TwoWire::setPins(int sda, int scl)
+{
+    (void)sda;
+    (void)scl;
+    return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency)
+{
+    _clock = frequency;
+    return true;
+}
+
+void TwoWire::beginTransmission(uint16_t address)
+{
+    _lock.lock();
+    _txAddr = address;
+    _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (_txLength >= I2C_BUFFER_LENGTH)
+    {
+        return 0;
+    }
+    _txBuffer[_txLength++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t size)
+{
+    size_t n = 0;
+    while (n < size && write(data[n]))
+    {
+        n++;
+    }
+    return n;
+}
+
+MockI2CTransaction *TwoWire::logTransaction(uint8_t addr, uint8_t read, const uint8_t *data, uint16_t length)
+{
+    // Start, address byte, payload and stop at 9 clocks per byte
+    uint32_t duration = (uint32_t)(((uint64_t)(length + 1) * 9 + 2) * 1000000 / _clock);
+    MockI2CTransaction *t = NULL;
+    if (_logCount < MOCK_I2C_LOG_SIZE)
+    {
+        t = &_log[_logCount++];
+        t->timestamp = micros();
+        t->duration = duration;
+        t->addr = addr;
+        t->read = read;
+        t->nack = _absent[addr & 0x7F];
+        t->length = length;
+        memcpy(t->data, data, length);
+    }
+    mockAdvanceMicros(duration);
+    return t;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    (void)sendStop;
+    logTransaction(_txAddr, 0, _txBuffer, _txLength);
+    _txLength = 0;
+    uint8_t err = _absent[_txAddr & 0x7F] ? 2 : 0;  // 2 is address NACK
+    _lock.unlock();
+    return err;
+}
+
+uint8_t TwoWire::requestFrom(uint16_t address, uint8_t size, bool sendStop)
+{
+    (void)sendStop;
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    if (size > sizeof(_readData[0]))
+    {
+        size = sizeof(_readData[0]);
+    }
+    memcpy(_rxBuffer, _readData[address & 0x7F], size);
+    logTransaction(address, 1, _rxBuffer, size);
+    _rxIndex = 0;
+    _rxLength = _absent[address & 0x7F] ? 0 : size;
+    return _rxLength;
+}
+
+int TwoWire::available()
+{
+    return _rxLength - _rxIndex;
+}
+
+int TwoWire::read()
+{
+    if (_rxIndex >= _rxLength)
+    {
+        return -1;
+    }
+    return _rxBuffer[_rxIndex++];
+}
+
+const MockI2CTransaction *TwoWire::transaction(uint32_t index)
+{
+    return index < _logCount ? &_log[index] : NULL;
+}
+
+uint32_t TwoWire::bytesTo(uint8_t addr)
+{
+    uint32_t bytes = 0;
+    for (uint32_t i = 0; i < _logCount; i++)
+    {
+        if (_log[i].addr == addr)
+        {
+            bytes += _log[i].length;
+        }
+    }
+    return bytes;
+}
+
+void TwoWire::mockSetPresent(uint8_t addr, bool present)
+{
+    _absent[addr & 0x7F] = !present;
+}
+
+void TwoWire::mockSetReadData(uint8_t addr, const uint8_t *data, uint8_t length)
+{
+    if (length > sizeof(_readData[0]))
+    {
+        length = sizeof(_readData[0]);
+    }
+    memcpy(_readData[addr & 0x7F], data, length);
+}
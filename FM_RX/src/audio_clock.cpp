@@ -0,0 +1,128 @@
+#include <audio_clock.h>
+
+const AudioClockConfig AUDIO_CLOCK_QUALITY = { 48000, 24, I2S_MCLK_MULTIPLE_384 };
+const AudioClockConfig AUDIO_CLOCK_LOW_POWER = { 32000, 16, I2S_MCLK_MULTIPLE_384 };
+
+AudioClock::AudioClock(i2s_port_t port, NAU8810 *codec, AudioPipeline *pipeline)
+{
+    _port = port;
+    _codec = codec;
+    _pipeline = pipeline;
+    memset(&_config, 0, sizeof(_config));
+    memset(&_pins, 0, sizeof(_pins));
+    _hook = NULL;
+    _hookCtx = NULL;
+}
+
+uint8_t AudioClock::begin(const AudioClockConfig *config, const i2s_pin_config_t *pins)
+{
+    _config = *config;
+    _pins = *pins;
+    _pipeline->setFormat(_config.sampleRate, _config.bitsPerSample);
+    return install();
+}
+
+uint8_t AudioClock::install()
+{
+    const i2s_config_t i2s_config = {
+        .mode = i2s_mode_t(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_TX),
+        .sample_rate = _config.sampleRate,
+        .bits_per_sample = i2s_bits_per_sample_t(_config.bitsPerSample),
+        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+        .communication_format = i2s_comm_format_t(I2S_COMM_FORMAT_STAND_I2S),
+        .intr_alloc_flags = 0,
+        .dma_buf_count = AUDIO_DMA_BUF_COUNT,
+        .dma_buf_len = AUDIO_BLOCK_SAMPLES,     // One pipeline block per DMA buffer
+        .use_apll = true,                       // Exact audio rates, the PLL_D2 dividers can't make 384 fs cleanly
+        .tx_desc_auto_clear = true,             // Underruns play silence, not the last buffer again
+        .fixed_mclk = 0,
+        .mclk_multiple = _config.mclkMultiple
+    };
+
+    if (i2s_driver_install(_port, &i2s_config, 0, NULL) != ESP_OK ||
+        i2s_set_pin(_port, &_pins) != ESP_OK ||
+        i2s_start(_port) != ESP_OK)
+    {
+        return AUDIO_CLOCK_ERR_I2S;
+    }
+    return 0;
+}
+
+uint8_t AudioClock::configureCodec(NAU8810PLLConfig *pll)
+{
+    return _codec->setClocking(mclk(), _config.sampleRate, _config.bitsPerSample, pll) ? AUDIO_CLOCK_ERR_CODEC : 0;
+}
+
+void AudioClock::setHook(AudioClockHook hook, void *ctx)
+{
+    _hook = hook;
+    _hookCtx = ctx;
+}
+
+// Order matters for a clean switch: the DAC ramps down while the old clocks
+// still run, the pipeline stops touching the driver, I2S and the codec move
+// together, then everything restarts and the DAC ramps back up. If either
+// side can't take the new format, both go back to the old one.
+uint8_t AudioClock::set(const AudioClockConfig *config)
+{
+    if (config->sampleRate == _config.sampleRate && config->bitsPerSample == _config.bitsPerSample &&
+        config->mclkMultiple == _config.mclkMultiple)
+    {
+        return 0;
+    }
+
+    bool wasMuted = _codec->readRegister(NAU_DAC_CTRL_ADDR) & NAU_DAC_SOFTMUTE;
+    _codec->updateRegister(NAU_DAC_CTRL_ADDR, NAU_DAC_SOFTMUTE, NAU_DAC_SOFTMUTE);
+    vTaskDelay(pdMS_TO_TICKS(AUDIO_CLOCK_MUTE_MS));
+
+    uint8_t err = 0;
+    if (!_pipeline->pause(AUDIO_CLOCK_PAUSE_MS))
+    {   // The task may still park on the request after the timeout
+        _pipeline->resume();
+        err = AUDIO_CLOCK_ERR_PAUSE;
+    }
+    else
+    {
+        AudioClockConfig previous = _config;
+        _config = *config;
+
+        // The MCLK multiple is only taken at install, a plain rate or width
+        // change can go through i2s_set_clk()
+        if (_config.mclkMultiple != previous.mclkMultiple)
+        {
+            i2s_driver_uninstall(_port);
+            err = install();
+        }
+        else if (i2s_set_clk(_port, _config.sampleRate, _config.bitsPerSample, I2S_CHANNEL_MONO) != ESP_OK)
+        {
+            err = AUDIO_CLOCK_ERR_I2S;
+        }
+
+        if (!err && configureCodec())
+        {
+            err = AUDIO_CLOCK_ERR_CODEC;
+        }
+        if (err)
+        {   // Driver state isn't known after a failure, start it again from scratch
+            _config = previous;
+            i2s_driver_uninstall(_port);
+            install();
+            configureCodec();
+        }
+
+        i2s_zero_dma_buffer(_port);     // No stale samples at the old rate
+        _pipeline->setFormat(_config.sampleRate, _config.bitsPerSample);
+        if (_hook)
+        {
+            _hook(_config.sampleRate, _hookCtx);
+        }
+        _pipeline->resume();
+    }
+
+    // Every path out, a failed pause included, leaves the mute as it found it
+    if (!wasMuted)
+    {
+        _codec->updateRegister(NAU_DAC_CTRL_ADDR, NAU_DAC_SOFTMUTE, 0);
+    }
+    return err;
+}
@@ -0,0 +1,57 @@
+#ifndef AUDIO_CLOCK_h
+#define AUDIO_CLOCK_h
+
+#include <Arduino.h>
+#include <driver/i2s.h>
+#include <nau8810.h>
+#include <audio_pipeline.h>
+
+#define AUDIO_CLOCK_MUTE_MS     NAU_SOFTMUTE_MS     // DAC soft-mute ramp allowed before the clocks move
+#define AUDIO_CLOCK_PAUSE_MS    50      // How long the pipeline gets to finish its block
+
+// set() errors
+#define AUDIO_CLOCK_ERR_I2S     1
+#define AUDIO_CLOCK_ERR_CODEC   2
+#define AUDIO_CLOCK_ERR_PAUSE   3
+
+// One I2S format, MCLK = sampleRate * mclkMultiple
+struct AudioClockConfig {
+    uint32_t sampleRate;
+    uint8_t bitsPerSample;                  // 16 or 24
+    i2s_mclk_multiple_t mclkMultiple;
+};
+
+extern const AudioClockConfig AUDIO_CLOCK_QUALITY;      // 48 kHz, 24-bit
+extern const AudioClockConfig AUDIO_CLOCK_LOW_POWER;    // 32 kHz, 16-bit, two thirds of the DMA interrupts and DSP work
+
+// Called with the pipeline parked, so stages can be redesigned for the new rate
+typedef void (*AudioClockHook)( uint32_t sampleRate, void *ctx );
+
+// Owns the audio clocking: the ESP32 I2S driver (APLL, MCLK multiple, word
+// length), the NAU8810 clock, PLL and filter rate registers and the
+// pipeline's sample format all come from one AudioClockConfig so they can't
+// drift apart. set() switches format at runtime with the DAC soft-muted and
+// the pipeline parked, so the change doesn't click.
+class AudioClock {
+    public:
+        AudioClock( i2s_port_t port, NAU8810 *codec, AudioPipeline *pipeline );
+        uint8_t begin( const AudioClockConfig *config, const i2s_pin_config_t *pins );  // Installs and starts I2S, MCLK runs from here on
+        uint8_t configureCodec( NAU8810PLLConfig *pll = NULL );    // Once the codec is up, matches it to the running format
+        uint8_t set( const AudioClockConfig *config );
+        void setHook( AudioClockHook hook, void *ctx );
+        const AudioClockConfig *config() { return &_config; }
+        uint32_t mclk() { return _config.sampleRate * _config.mclkMultiple; }
+
+    private:
+        uint8_t install();
+
+        i2s_port_t _port;
+        NAU8810 *_codec;
+        AudioPipeline *_pipeline;
+        AudioClockConfig _config;
+        i2s_pin_config_t _pins;
+        AudioClockHook _hook;
+        void *_hookCtx;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include <audio_filters.h>
+#include <math.h>
+
+static int32_t saturate32(int64_t value)
+{
+    if (value > INT32_MAX)
+    {
+        return INT32_MAX;
+    }
+    if (value < INT32_MIN)
+    {
+        return INT32_MIN;
+    }
+    return (int32_t)value;
+}
+
+// DESIGN
+
+static int32_t toQ30(float value)
+{
+    return (int32_t)lroundf(value * (float)(1L << BIQUAD_Q31_SHIFT));
+}
+
+// Scales by 1 / a0 and converts, RBJ cookbook form
+static void setNormalized(BiquadCoeffs *c, float b0, float b1, float b2, float a0, float a1, float a2)
+{
+    c->b0 = toQ30(b0 / a0);
+    c->b1 = toQ30(b1 / a0);
+    c->b2 = toQ30(b2 / a0);
+    c->a1 = toQ30(a1 / a0);
+    c->a2 = toQ30(a2 / a0);
+}
+
+void designLowPass(BiquadCoeffs *c, uint32_t fs, float fc, float q)
+{
+    float w0 = 2.0f * (float)M_PI * fc / fs;
+    float alpha = sinf(w0) / (2.0f * q);
+    float cosw = cosf(w0);
+    setNormalized(c, (1.0f - cosw) / 2.0f, 1.0f - cosw, (1.0f - cosw) / 2.0f, 1.0f + alpha, -2.0f * cosw, 1.0f - alpha);
+}
+
+void designHighPass(BiquadCoeffs *c, uint32_t fs, float fc, float q)
+{
+    float w0 = 2.0f * (float)M_PI * fc / fs;
+    float alpha = sinf(w0) / (2.0f * q);
+    float cosw = cosf(w0);
+    setNormalized(c, (1.0f + cosw) / 2.0f, -(1.0f + cosw), (1.0f + cosw) / 2.0f, 1.0f + alpha, -2.0f * cosw, 1.0f - alpha);
+}
+
+void designNotch(BiquadCoeffs *c, uint32_t fs, float fc, float q)
+{
+    float w0 = 2.0f * (float)M_PI * fc / fs;
+    float alpha = sinf(w0) / (2.0f * q);
+    float cosw = cosf(w0);
+    setNormalized(c, 1.0f, -2.0f * cosw, 1.0f, 1.0f + alpha, -2.0f * cosw, 1.0f - alpha);
+}
+
+// 1 / (1 + s tau) through the bilinear transform, prewarped so the corner
+// (3.18 kHz for 50 us, 2.12 kHz for 75 us) lands where the analog one does
+void designDeemphasis(BiquadCoeffs *c, uint32_t fs, uint16_t tau_us)
+{
+    float fc = 1.0f / (2.0f * (float)M_PI * tau_us * 1e-6f);
+    float k = tanf((float)M_PI * fc / fs);
+    setNormalized(c, k, k, 0.0f, 1.0f + k, k - 1.0f, 0.0f);
+}
+
+// BIQUADS
+
+BiquadQ31::BiquadQ31()
+{
+    memset(&_c, 0, sizeof(_c));
+    _c.b0 = 1L << BIQUAD_Q31_SHIFT;     // Pass-through until configured
+    reset();
+}
+
+bool BiquadQ31::setCoeffs(const BiquadCoeffs *c)
+{
+    // Stability triangle, |a2| < 1 and |a1| < 1 + a2
+    const int64_t one = 1LL << BIQUAD_Q31_SHIFT;
+    int64_t a1 = c->a1, a2 = c->a2;
+    if (a2 >= one || a2 <= -one || a1 >= one + a2 || a1 <= -(one + a2))
+    {
+        return false;
+    }
+    _c = *c;
+    return true;
+}
+
+void BiquadQ31::reset()
+{
+    _x1 = _x2 = _y1 = _y2 = 0;
+}
+
+void BiquadQ31::process(int32_t *block, uint16_t count)
+{
+    // Locals so the compiler keeps state and coefficients in registers. The
+    // state is held already shifted down by BIQUAD_HEADROOM.
+    const int64_t b0 = _c.b0, b1 = _c.b1, b2 = _c.b2, a1 = _c.a1, a2 = _c.a2;
+    int32_t x1 = _x1, x2 = _x2, y1 = _y1, y2 = _y2;
+    const uint8_t shift = BIQUAD_Q31_SHIFT - BIQUAD_HEADROOM;
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        int32_t x = block[i] >> BIQUAD_HEADROOM;
+        int64_t acc = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        int32_t y = saturate32((acc + (1LL << (shift - 1))) >> shift);
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y >> BIQUAD_HEADROOM;
+        block[i] = y;
+    }
+
+    _x1 = x1;
+    _x2 = x2;
+    _y1 = y1;
+    _y2 = y2;
+}
+
+// CHAIN
+
+FilterChain::FilterChain()
+{
+    _numSections = 0;
+}
+
+bool FilterChain::addSection(const BiquadCoeffs *c)
+{
+    if (_numSections >= FILTER_MAX_SECTIONS)
+    {
+        return false;
+    }
+    if (!_sections[_numSections].setCoeffs(c))
+    {
+        return false;
+    }
+    _sections[_numSections].reset();
+    _numSections++;
+    return true;
+}
+
+void FilterChain::clear()
+{
+    _numSections = 0;
+}
+
+void FilterChain::process(int32_t *block, uint16_t count)
+{
+    for (uint8_t i = 0; i < _numSections; i++)
+    {
+        _sections[i].process(block, count);
+    }
+}
+
+void FilterChain::stage(int32_t *block, uint16_t count, void *ctx)
+{
+    ((FilterChain *)ctx)->process(block, count);
+}
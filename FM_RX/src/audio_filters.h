@@ -0,0 +1,57 @@
+#ifndef AUDIO_FILTERS_h
+#define AUDIO_FILTERS_h
+
+#include <Arduino.h>
+
+#define BIQUAD_Q31_SHIFT    30      // Biquad coefficients for Q31 data are Q2.30
+#define BIQUAD_HEADROOM     1       // Bits samples are shifted down by inside the products
+#define FILTER_MAX_SECTIONS 4       // Biquads in one FilterChain
+
+#define DEEMPHASIS_EU_US    50      // Broadcast de-emphasis time constants
+#define DEEMPHASIS_US_US    75
+
+// Normalized so a0 = 1, H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+struct BiquadCoeffs {
+    int32_t b0, b1, b2, a1, a2;     // Q2.30
+};
+
+// Filter design, float math meant for init time rather than the audio task
+void designLowPass( BiquadCoeffs *c, uint32_t fs, float fc, float q );
+void designHighPass( BiquadCoeffs *c, uint32_t fs, float fc, float q );
+void designNotch( BiquadCoeffs *c, uint32_t fs, float fc, float q );
+void designDeemphasis( BiquadCoeffs *c, uint32_t fs, uint16_t tau_us );    // First order, b2 = a2 = 0
+
+// Direct form I, so the state stays at the data's scale and a coefficient
+// change doesn't pop. Products accumulate in 64 bits (Xtensa MULL/MULSH pair)
+// with the samples one bit down, which is free on 24-bit data and keeps five
+// full-scale products at any Q2.30 coefficient inside the accumulator. The
+// output saturates instead of wrapping. Plain C: the recursion is serial, so
+// PIE has nothing to vectorise across samples, and the S3-optimised esp-dsp
+// biquads are float only.
+class BiquadQ31 {
+    public:
+        BiquadQ31();
+        bool setCoeffs( const BiquadCoeffs *c );   // False for poles on or outside the unit circle, previous ones kept
+        void reset();
+        void process( int32_t *block, uint16_t count );
+
+    private:
+        BiquadCoeffs _c;
+        int32_t _x1, _x2, _y1, _y2;
+};
+
+// Cascade of Q31 biquads that plugs into AudioPipeline as one stage
+class FilterChain {
+    public:
+        FilterChain();
+        bool addSection( const BiquadCoeffs *c );  // False when full or the section is unstable
+        void clear();
+        void process( int32_t *block, uint16_t count );
+        static void stage( int32_t *block, uint16_t count, void *ctx );    // AudioStageFn, ctx is the chain
+
+    private:
+        BiquadQ31 _sections[FILTER_MAX_SECTIONS];
+        uint8_t _numSections;
+};
+
+#endif
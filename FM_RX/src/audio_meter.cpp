@@ -0,0 +1,196 @@
+#include <audio_meter.h>
+#include <math.h>
+
+AudioMeter::AudioMeter()
+{
+    portMUX_INITIALIZE(&_mux);
+    _restart = true;
+    _power = 0;
+    _hissPower = 0;
+    _floorPower = 0;
+    _peak = 0;
+    _last = 0;
+    _blocks = 0;
+    _settleLeft = 0;
+    _windowLeft = 0;
+    _windowBlocks = 1;     // Keeps readWindow() safe before the first window
+    _windowPower = 0;
+    _windowHiss = 0;
+    _windowPeak = 0;
+    _windowNotify = NULL;
+    _windowReady = false;
+}
+
+void AudioMeter::stage(int32_t *block, uint16_t count, void *ctx)
+{
+    ((AudioMeter *)ctx)->process(block, count);
+}
+
+void AudioMeter::restart()
+{
+    _restart = true;
+}
+
+void AudioMeter::process(const int32_t *block, uint16_t count)
+{
+    if (!count)
+    {
+        return;
+    }
+
+    // Drop to the codec's 24 bits so 128 squares sum well inside 64 bits
+    uint64_t sum = 0;
+    uint64_t hiss = 0;
+    uint32_t peak = 0;
+    int32_t last = _last;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        int32_t x = block[i] >> 8;
+        int32_t d = x - last;
+        uint32_t mag = x < 0 ? -x : x;
+        sum += (int64_t)x * x;
+        hiss += (int64_t)d * d;
+        peak = max(peak, mag);
+        last = x;
+    }
+    _last = last;
+    sum /= count;
+    hiss /= count;
+
+    portENTER_CRITICAL(&_mux);
+    if (_restart)
+    {
+        _power = sum;
+        _hissPower = hiss;
+        _floorPower = sum;
+        _peak = peak;
+        _blocks = 0;
+        _restart = false;
+    }
+    else
+    {
+        _power = _power - (_power >> METER_SMOOTH_SHIFT) + (sum >> METER_SMOOTH_SHIFT);
+        _hissPower = _hissPower - (_hissPower >> METER_SMOOTH_SHIFT) + (hiss >> METER_SMOOTH_SHIFT);
+        if (sum < _floorPower)
+        {
+            _floorPower = sum;
+        }
+        else
+        {
+            _floorPower += (sum - _floorPower) >> METER_FLOOR_SHIFT;
+        }
+        _peak = max(peak, _peak - (_peak >> METER_PEAK_SHIFT));
+    }
+    _blocks++;
+
+    TaskHandle_t notify = NULL;
+    if (_settleLeft)
+    {
+        _settleLeft--;
+    }
+    else if (_windowLeft)
+    {
+        _windowPower += sum;
+        _windowHiss += hiss;
+        _windowPeak = max(_windowPeak, peak);
+        if (--_windowLeft == 0)
+        {
+            _windowReady = true;
+            notify = _windowNotify;
+        }
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    if (notify)
+    {
+        xTaskNotifyGive(notify);
+    }
+}
+
+void AudioMeter::startWindow(uint8_t settleBlocks, uint8_t windowBlocks, TaskHandle_t notify)
+{
+    portENTER_CRITICAL(&_mux);
+    _settleLeft = settleBlocks;
+    _windowLeft = windowBlocks ? windowBlocks : 1;
+    _windowBlocks = _windowLeft;
+    _windowPower = 0;
+    _windowHiss = 0;
+    _windowPeak = 0;
+    _windowNotify = notify;
+    _windowReady = false;
+    portEXIT_CRITICAL(&_mux);
+}
+
+// Mean square of 24-bit samples to dB * 10 relative to a full-scale square wave
+static int16_t powerToDb10(uint64_t power)
+{
+    if (!power)
+    {
+        return METER_MIN_DB10;
+    }
+    float db = 10.0f * log10f((float)power / (float)(1ULL << 46));
+    return max((int16_t)METER_MIN_DB10, (int16_t)lroundf(db * 10.0f));
+}
+
+static int16_t peakToDb10(uint32_t peak)
+{
+    if (!peak)
+    {
+        return METER_MIN_DB10;
+    }
+    return max((int16_t)METER_MIN_DB10, (int16_t)lroundf(200.0f * log10f((float)peak / (float)(1UL << 23))));
+}
+
+void AudioMeter::read(MeterReading *reading)
+{
+    portENTER_CRITICAL(&_mux);
+    uint64_t power = _power;
+    uint64_t hissPower = _hissPower;
+    uint64_t floorPower = _floorPower;
+    uint32_t peak = _peak;
+    reading->blocks = _blocks;
+    portEXIT_CRITICAL(&_mux);
+
+    reading->rms = powerToDb10(power);
+    reading->hiss = powerToDb10(hissPower);
+    reading->floor = powerToDb10(floorPower);
+    reading->peak = peakToDb10(peak);
+}
+
+// Floor is reported as the window's RMS, a single window has no history
+void AudioMeter::readWindow(MeterReading *reading)
+{
+    portENTER_CRITICAL(&_mux);
+    uint64_t power = _windowPower / _windowBlocks;
+    uint64_t hissPower = _windowHiss / _windowBlocks;
+    uint32_t peak = _windowPeak;
+    reading->blocks = _windowBlocks;
+    portEXIT_CRITICAL(&_mux);
+
+    reading->rms = powerToDb10(power);
+    reading->hiss = powerToDb10(hissPower);
+    reading->floor = reading->rms;
+    reading->peak = peakToDb10(peak);
+}
+
+uint8_t AudioMeter::quality()
+{
+    MeterReading reading;
+    read(&reading);
+    return quality(&reading);
+}
+
+// Nothing measured yet (no codec, pipeline stopped, first block pending)
+// reads as no signal rather than as a perfectly quiet one
+uint8_t AudioMeter::quality(const MeterReading *reading)
+{
+    if (reading->blocks == 0 || reading->hiss >= METER_HISS_NOISY_DB10)
+    {
+        return 0;
+    }
+    if (reading->hiss <= METER_HISS_QUIET_DB10)
+    {
+        return 100;
+    }
+    return (METER_HISS_NOISY_DB10 - reading->hiss) * 100 / (METER_HISS_NOISY_DB10 - METER_HISS_QUIET_DB10);
+}
@@ -0,0 +1,67 @@
+#ifndef AUDIO_METER_h
+#define AUDIO_METER_h
+
+#include <Arduino.h>
+
+#define METER_SMOOTH_SHIFT  3       // RMS and hiss average over ~8 blocks (21 ms)
+#define METER_FLOOR_SHIFT   10      // Noise floor creeps up over ~1000 blocks (2.7 s), drops at once
+#define METER_PEAK_SHIFT    4       // Peak hold decays 1/16 per block
+#define METER_MIN_DB10      -1400   // Reported for digital silence
+
+// Hiss levels mapped to the 0 - 100 quality score. FM noise is mostly high
+// frequency and falls away as the signal gets stronger (quieting).
+#define METER_HISS_NOISY_DB10   -200
+#define METER_HISS_QUIET_DB10   -700
+
+#define METER_MAX_WINDOW    255     // Blocks in one startWindow() measurement
+
+// Levels in tenths of a dB relative to full scale
+struct MeterReading {
+    int16_t rms;
+    int16_t peak;
+    int16_t floor;          // Quietest recent RMS
+    int16_t hiss;           // Energy of the first difference, a cheap high-pass
+    uint32_t blocks;        // Blocks measured since begin or restart()
+};
+
+// Runs as an AudioPipeline stage and only reads the block, so it can sit
+// anywhere in the chain. The audio task accumulates raw energies; the dB
+// conversion happens in read(), on the caller's time.
+class AudioMeter {
+    public:
+        AudioMeter();
+        void process( const int32_t *block, uint16_t count );
+        static void stage( int32_t *block, uint16_t count, void *ctx );    // AudioStageFn, ctx is the meter
+        void restart();                         // Drop the averages, e.g. after a retune
+        void read( MeterReading *reading );
+        uint8_t quality();                      // 0 (all hiss or no data) - 100 (fully quieted)
+        static uint8_t quality( const MeterReading *reading );
+
+        // One-shot measurement for seek/scan: skip settleBlocks (retune transient
+        // and blocks already in the DMA queue), then plain-average the next
+        // windowBlocks. The task is notified from the audio task when it's done.
+        void startWindow( uint8_t settleBlocks, uint8_t windowBlocks, TaskHandle_t notify );
+        bool windowReady() { return _windowReady; }
+        void readWindow( MeterReading *reading );
+
+    private:
+        portMUX_TYPE _mux;
+        uint64_t _power;        // Mean square of 24-bit samples, smoothed
+        uint64_t _hissPower;
+        uint64_t _floorPower;
+        uint32_t _peak;         // 24-bit magnitude
+        int32_t _last;          // Previous sample for the first difference
+        uint32_t _blocks;
+        volatile bool _restart;
+
+        uint8_t _settleLeft;
+        uint8_t _windowLeft;
+        uint8_t _windowBlocks;
+        uint64_t _windowPower;   // Sums over the window
+        uint64_t _windowHiss;
+        uint32_t _windowPeak;
+        TaskHandle_t _windowNotify;
+        volatile bool _windowReady;
+};
+
+#endif
@@ -0,0 +1,208 @@
+#include <audio_pipeline.h>
+
+AudioPipeline::AudioPipeline(i2s_port_t port)
+{
+    _port = port;
+    _task = NULL;
+    portMUX_INITIALIZE(&_mux);
+    _numStages = 0;
+    memset(&_stats, 0, sizeof(_stats));
+    _sampleRate = 48000;
+    _bytesPerSample = sizeof(int32_t);
+    _pauseRequest = false;
+    _paused = false;
+}
+
+void AudioPipeline::setFormat(uint32_t sampleRate, uint8_t bitsPerSample)
+{
+    _sampleRate = sampleRate;
+    _bytesPerSample = bitsPerSample <= 16 ? sizeof(int16_t) : sizeof(int32_t);
+}
+
+// The task is normally blocked in i2s_read, so this returns within a block
+// period as long as the I2S clocks are running. On a timeout the request
+// stays raised, the task can still park on it at any moment, so the caller
+// has to resume() either way.
+bool AudioPipeline::pause(uint32_t timeoutMs)
+{
+    if (!_task)
+    {
+        return true;
+    }
+    _pauseRequest = true;
+    uint32_t start = millis();
+    while (!_paused)
+    {
+        if (millis() - start >= timeoutMs)
+        {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+// Notifies whenever a request was raised, whether or not the task got as far
+// as parking. A notification it never waited for is harmless, the task only
+// leaves the parked state once the request is gone.
+void AudioPipeline::resume()
+{
+    if (_task && (_pauseRequest || _paused))
+    {
+        _pauseRequest = false;
+        xTaskNotifyGive(_task);
+    }
+}
+
+bool AudioPipeline::begin()
+{
+    if (_task)
+    {
+        return true;
+    }
+    if (xTaskCreatePinnedToCore(audioTask, "audio", AUDIO_TASK_STACK, this, AUDIO_TASK_PRIORITY, &_task, AUDIO_TASK_CORE) != pdPASS)
+    {
+        _task = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool AudioPipeline::addStage(AudioStageFn fn, void *ctx)
+{
+    bool added = false;
+    portENTER_CRITICAL(&_mux);
+    if (_numStages < AUDIO_MAX_STAGES)
+    {
+        _stages[_numStages].fn = fn;
+        _stages[_numStages].ctx = ctx;
+        _numStages++;
+        added = true;
+    }
+    portEXIT_CRITICAL(&_mux);
+    return added;
+}
+
+void AudioPipeline::clearStages()
+{
+    portENTER_CRITICAL(&_mux);
+    _numStages = 0;
+    portEXIT_CRITICAL(&_mux);
+}
+
+void AudioPipeline::getStats(AudioStats *stats)
+{
+    portENTER_CRITICAL(&_mux);
+    *stats = _stats;
+    portEXIT_CRITICAL(&_mux);
+}
+
+void AudioPipeline::resetStats()
+{
+    portENTER_CRITICAL(&_mux);
+    memset(&_stats, 0, sizeof(_stats));
+    portEXIT_CRITICAL(&_mux);
+}
+
+void AudioPipeline::dump(Print *out)
+{
+    AudioStats stats;
+    getStats(&stats);
+    // Budget is one block period worth of cycles
+    uint32_t budget = getCpuFrequencyMhz() * 1000000ULL * AUDIO_BLOCK_SAMPLES / _sampleRate;
+    out->printf("Audio: %u Hz %u-bit, %u blocks, %u short reads, %u short writes, %u driver errors\n", _sampleRate,
+                _bytesPerSample == 2 ? 16 : 24, stats.blocks, stats.shortReads, stats.shortWrites, stats.driverErrors);
+    out->printf("Stage chain: %u cycles last, %u max, %u%% of the block budget\n", stats.lastCycles, stats.maxCycles,
+                budget ? stats.maxCycles * 100 / budget : 0);
+}
+
+void AudioPipeline::audioTask(void *param)
+{
+    ((AudioPipeline *)param)->run();
+}
+
+// The DMA buffers are the only ring buffers needed: i2s_read blocks until the
+// RX side has a full block, and i2s_write blocks until the TX side has room,
+// so the task is paced by the codec's word clock.
+void AudioPipeline::run()
+{
+    AudioStage stages[AUDIO_MAX_STAGES];
+
+    while (1)
+    {
+        if (_pauseRequest)
+        {
+            _paused = true;
+            while (_pauseRequest)
+            {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            }
+            _paused = false;
+            continue;
+        }
+
+        // 16-bit frames land packed in the front of the block and are widened
+        // in place, back to front so nothing is overwritten before it is read
+        uint8_t width = _bytesPerSample;
+        size_t bytes = 0;
+        if (i2s_read(_port, _block, AUDIO_BLOCK_SAMPLES * width, &bytes, portMAX_DELAY) != ESP_OK || bytes < width)
+        {   // An uninstalled driver returns at once, don't starve core 0
+            portENTER_CRITICAL(&_mux);
+            _stats.driverErrors++;
+            portEXIT_CRITICAL(&_mux);
+            vTaskDelay(1);
+            continue;
+        }
+        uint16_t count = bytes / width;
+        if (width == sizeof(int16_t))
+        {
+            const int16_t *raw = (const int16_t *)_block;
+            for (uint16_t i = count; i-- > 0;)
+            {
+                _block[i] = (int32_t)raw[i] << 16;
+            }
+        }
+        if (count < AUDIO_BLOCK_SAMPLES)
+        {   // Pad so the DAC doesn't lose sync with the ADC
+            memset(&_block[count], 0, sizeof(_block) - count * sizeof(int32_t));
+        }
+
+        // Snapshot the chain so loop() can change it between blocks
+        portENTER_CRITICAL(&_mux);
+        uint8_t numStages = _numStages;
+        memcpy(stages, _stages, numStages * sizeof(AudioStage));
+        portEXIT_CRITICAL(&_mux);
+
+        uint32_t start = ESP.getCycleCount();
+        for (uint8_t i = 0; i < numStages; i++)
+        {
+            stages[i].fn(_block, AUDIO_BLOCK_SAMPLES, stages[i].ctx);
+        }
+        uint32_t cycles = ESP.getCycleCount() - start;
+
+        if (width == sizeof(int16_t))
+        {
+            int16_t *raw = (int16_t *)_block;
+            for (uint16_t i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+            {
+                raw[i] = _block[i] >> 16;
+            }
+        }
+        size_t written = 0;
+        bool writeFailed = i2s_write(_port, _block, AUDIO_BLOCK_SAMPLES * width, &written, portMAX_DELAY) != ESP_OK;
+
+        portENTER_CRITICAL(&_mux);
+        _stats.blocks++;
+        _stats.driverErrors += writeFailed ? 1 : 0;
+        _stats.shortReads += count < AUDIO_BLOCK_SAMPLES ? 1 : 0;
+        _stats.shortWrites += written < AUDIO_BLOCK_SAMPLES * width ? 1 : 0;
+        _stats.lastCycles = cycles;
+        _stats.maxCycles = max(_stats.maxCycles, cycles);
+        portEXIT_CRITICAL(&_mux);
+
+        if (writeFailed)
+        {
+            vTaskDelay(1);
+        }
+    }
+}
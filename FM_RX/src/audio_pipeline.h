@@ -0,0 +1,70 @@
+#ifndef AUDIO_PIPELINE_h
+#define AUDIO_PIPELINE_h
+
+#include <Arduino.h>
+#include <driver/i2s.h>
+
+#define AUDIO_BLOCK_SAMPLES     128     // 2.67 ms at 48 kHz, 4 ms at 32 kHz
+#define AUDIO_DMA_BUF_COUNT     4       // Per direction, ~10.7 ms of slack before an overrun
+#define AUDIO_MAX_STAGES        8
+
+#define AUDIO_TASK_CORE         0
+#define AUDIO_TASK_PRIORITY     10      // Above the display and battery tasks, a late block is an audible click
+#define AUDIO_TASK_STACK        4096
+
+// Processes one block in place. Samples are mono, codec data MSB-aligned in
+// 32-bit words whatever the I2S word length, so they can be treated as Q31.
+typedef void (*AudioStageFn)( int32_t *block, uint16_t count, void *ctx );
+
+struct AudioStage {
+    AudioStageFn fn;
+    void *ctx;
+};
+
+struct AudioStats {
+    uint32_t blocks;
+    uint32_t shortReads;        // i2s_read returned less than a block
+    uint32_t shortWrites;       // i2s_write timed out with part of a block left
+    uint32_t driverErrors;      // i2s_read/i2s_write failed or read nothing, the task backed off a tick
+    uint32_t lastCycles;        // CPU cycles the stage chain took on the last block
+    uint32_t maxCycles;
+};
+
+// Reads blocks from the codec ADC (NAU_ADCOUT), runs them through a chain of
+// stages and writes them back out to the DAC (NAU_DACIN). The I2S port has to
+// be installed as RX + TX before begin(). Should the driver go away anyway
+// (a failed reinstall in AudioClock::set()) the task idles a tick per pass
+// rather than spinning at its priority.
+class AudioPipeline {
+    public:
+        AudioPipeline( i2s_port_t port );
+        bool begin();
+        void setFormat( uint32_t sampleRate, uint8_t bitsPerSample );   // Match the I2S driver, only before begin() or while paused
+        uint32_t sampleRate() { return _sampleRate; }
+        bool pause( uint32_t timeoutMs );   // Parks the task between blocks so I2S can be reconfigured, false on timeout; resume() in both cases
+        void resume();
+        bool running() { return _task != NULL; }    // False before begin() or if the task couldn't start
+        bool addStage( AudioStageFn fn, void *ctx );    // Safe while running, returns false when full
+        void clearStages();
+        void getStats( AudioStats *stats );
+        void resetStats();
+        void dump( Print *out );
+
+    private:
+        void run();
+        static void audioTask( void *param );
+
+        i2s_port_t _port;
+        TaskHandle_t _task;
+        portMUX_TYPE _mux;                      // Guards the stage list and stats
+        AudioStage _stages[AUDIO_MAX_STAGES];
+        uint8_t _numStages;
+        AudioStats _stats;
+        uint32_t _sampleRate;
+        uint8_t _bytesPerSample;    // 2 for 16-bit I2S, 4 for anything wider
+        volatile bool _pauseRequest;
+        volatile bool _paused;
+        int32_t _block[AUDIO_BLOCK_SAMPLES];
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include <band_scanner.h>
+
+BandScanner::BandScanner(LOTuner *lo, AudioMeter *meter)
+{
+    _tuner = lo;
+    _meter = meter;
+    _notify = NULL;
+    _mode = SCAN_IDLE;
+    _lo = 0;
+    _station = 0;
+    _numStations = 0;
+    _channels = 0;
+    _startTime = 0;
+    _elapsed = 0;
+}
+
+// Retunes and arms the meter, the window result is read in step()
+void BandScanner::measure(uint64_t station)
+{
+    _station = station;
+    _lo = station - IF_FREQ;
+    _tuner->setFrequency(_lo);     // Raster channels come from the register table, ~200 us on the bus
+    _meter->startWindow(SCAN_SETTLE_BLOCKS, SCAN_WINDOW_BLOCKS, _notify);
+    _channels++;
+}
+
+uint8_t BandScanner::readQuality()
+{
+    MeterReading reading;
+    _meter->readWindow(&reading);
+    return AudioMeter::quality(&reading);
+}
+
+void BandScanner::startScan(uint64_t fromLo, TaskHandle_t notify)
+{
+    _notify = notify;
+    _mode = SCAN_COARSE;
+    _startStation = fromLo + IF_FREQ;
+    _index = 0;
+    _numStations = 0;
+    _channels = 0;
+    _startTime = millis();
+    measure(LO_BAND_START);
+}
+
+// Snaps to the 100 kHz raster and starts climbing from the next channel over
+void BandScanner::startSeek(uint64_t fromLo, int8_t direction, TaskHandle_t notify)
+{
+    uint64_t station = fromLo + IF_FREQ;
+    if (station < LO_BAND_START)
+    {
+        station = LO_BAND_START;
+    }
+    else if (station > LO_BAND_END)
+    {
+        station = LO_BAND_END;
+    }
+    station = LO_BAND_START + (station - LO_BAND_START + SCAN_FINE_STEP / 2) / SCAN_FINE_STEP * SCAN_FINE_STEP;
+
+    _notify = notify;
+    _mode = SCAN_SEEK;
+    _direction = direction < 0 ? -1 : 1;
+    _startStation = station;
+    _best = 0;
+    _seekSteps = 0;
+    // Starting between stations, the very next channel may already be one
+    _seekArmed = _meter->quality() < SCAN_THRESHOLD;
+    _channels = 0;
+    _startTime = millis();
+    _station = station;
+    measure(nextSeekStation());
+}
+
+uint64_t BandScanner::nextSeekStation()
+{
+    if (_direction > 0)
+    {
+        return _station + SCAN_FINE_STEP > LO_BAND_END ? LO_BAND_START : _station + SCAN_FINE_STEP;
+    }
+    return _station < LO_BAND_START + SCAN_FINE_STEP ? LO_BAND_END : _station - SCAN_FINE_STEP;
+}
+
+void BandScanner::abort()
+{
+    if (_mode != SCAN_IDLE)
+    {
+        _mode = SCAN_IDLE;
+        _elapsed = millis() - _startTime;
+    }
+}
+
+bool BandScanner::finish(uint64_t station)
+{
+    _mode = SCAN_IDLE;
+    _elapsed = millis() - _startTime;
+    _station = station;
+    _lo = station - IF_FREQ;
+    _tuner->setFrequency(_lo);
+    return true;
+}
+
+// Adjacent coarse peaks can refine onto the same channel, keep the better one
+void BandScanner::addStation(uint64_t station, uint8_t quality)
+{
+    if (_numStations)
+    {
+        ScanStation *last = &_stations[_numStations - 1];
+        if (station - last->freq <= SCAN_FINE_STEP)
+        {
+            if (quality > last->quality)
+            {
+                last->freq = station;
+                last->quality = quality;
+            }
+            return;
+        }
+    }
+    if (_numStations < SCAN_MAX_STATIONS)
+    {
+        _stations[_numStations].freq = station;
+        _stations[_numStations].quality = quality;
+        _numStations++;
+    }
+}
+
+// Measures the next point either side of the current candidate, false once
+// both sides are done
+bool BandScanner::nextFinePoint()
+{
+    uint64_t centre = LO_BAND_START + (uint64_t)_index * SCAN_COARSE_STEP;
+    while (_fineStep < 2)
+    {
+        uint64_t station = _fineStep == 0 ? centre - SCAN_FINE_STEP : centre + SCAN_FINE_STEP;
+        _fineStep++;
+        if (station >= LO_BAND_START && station <= LO_BAND_END)
+        {
+            measure(station);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Moves on to the next coarse local maximum above threshold and measures
+// around it, false when the coarse list is exhausted
+bool BandScanner::nextCandidate()
+{
+    for (; _index < SCAN_COARSE_POINTS; _index++)
+    {
+        uint8_t q = _coarse[_index];
+        uint8_t left = _index ? _coarse[_index - 1] : 0;
+        uint8_t right = _index + 1U < SCAN_COARSE_POINTS ? _coarse[_index + 1] : 0;
+        if (q < SCAN_THRESHOLD || q < left || q <= right)
+        {
+            continue;
+        }
+
+        _best = q;
+        _bestStation = LO_BAND_START + (uint64_t)_index * SCAN_COARSE_STEP;
+        _fineStep = 0;
+        if (nextFinePoint())
+        {
+            return true;
+        }
+        addStation(_bestStation, _best);
+    }
+    return false;
+}
+
+bool BandScanner::step()
+{
+    if (_mode == SCAN_IDLE)
+    {
+        return false;
+    }
+
+    uint8_t q = readQuality();
+
+    switch (_mode)
+    {
+    case SCAN_COARSE:
+        _coarse[_index++] = q;
+        if (_index < SCAN_COARSE_POINTS)
+        {
+            measure(LO_BAND_START + (uint64_t)_index * SCAN_COARSE_STEP);
+            return false;
+        }
+        _mode = SCAN_FINE;
+        _index = 0;
+        break;
+
+    case SCAN_FINE:
+        if (q > _best)
+        {
+            _best = q;
+            _bestStation = _station;
+        }
+        if (nextFinePoint())
+        {
+            return false;
+        }
+        addStation(_bestStation, _best);
+        _index++;
+        break;
+
+    case SCAN_SEEK:
+        if (_best)
+        {   // Climbing a station, stop once past its peak
+            if (q <= _best)
+            {
+                return finish(_bestStation);
+            }
+            _best = q;
+            _bestStation = _station;
+        }
+        else if (q >= SCAN_THRESHOLD && _seekArmed)
+        {
+            _best = q;
+            _bestStation = _station;
+        }
+        else if (q < SCAN_THRESHOLD)
+        {   // Off the shoulder of the station we started on
+            _seekArmed = true;
+        }
+        if (!_best && ++_seekSteps >= LO_NUM_CHANNELS)
+        {   // Went all the way round without finding anything
+            return finish(_startStation);
+        }
+        measure(nextSeekStation());
+        return false;
+    }
+
+    // Fine pass
+    if (nextCandidate())
+    {
+        return false;
+    }
+
+    // Land on the strongest station found, or go back to where we started
+    uint64_t result = _startStation;
+    uint8_t best = 0;
+    for (uint8_t i = 0; i < _numStations; i++)
+    {
+        if (_stations[i].quality > best)
+        {
+            best = _stations[i].quality;
+            result = _stations[i].freq;
+        }
+    }
+    return finish(result);
+}
+
+void BandScanner::dump(Print *out)
+{
+    out->printf("%s: %u channels in %u ms, %u stations\n", _mode == SCAN_IDLE ? "Scan" : "Scanning",
+                _channels, _elapsed, _numStations);
+    for (uint8_t i = 0; i < _numStations; i++)
+    {
+        uint32_t khz = _stations[i].freq / 1000;
+        out->printf("%4u.%u MHz  quality %u\n", khz / 1000, (khz % 1000) / 100, _stations[i].quality);
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef BAND_SCANNER_h
+#define BAND_SCANNER_h
+
+#include <Arduino.h>
+#include <lo_tuner.h>
+#include <audio_meter.h>
+
+#define SCAN_COARSE_STEP        200000      // Coarse pass raster, half the stations land on it exactly
+#define SCAN_FINE_STEP          100000      // Fine pass checks this far either side of a coarse peak
+#define SCAN_COARSE_POINTS      ((LO_BAND_END - LO_BAND_START) / SCAN_COARSE_STEP + 1)  // 103
+#define SCAN_MAX_STATIONS       32
+#define SCAN_THRESHOLD          50          // Minimum AudioMeter quality for a station
+
+// Per measured channel. Settle covers PLL lock, the IF/demod transient and
+// the blocks still queued in DMA when the LO moved (4 deep), plus one block
+// of margin; at 128 samples per block a channel costs 13 blocks = 35 ms.
+#define SCAN_SETTLE_BLOCKS      5
+#define SCAN_WINDOW_BLOCKS      8
+
+struct ScanStation {
+    uint32_t freq;          // Station frequency in Hz (LO + IF)
+    uint8_t quality;
+};
+
+enum ScanMode {
+    SCAN_IDLE,
+    SCAN_COARSE,
+    SCAN_FINE,
+    SCAN_SEEK
+};
+
+// Seek and band scan, driven a channel at a time from loop(). Each step reads
+// the finished measurement window, retunes straight to the next channel and
+// arms the next window, so the only dead time per channel is the settle
+// period. The audio task wakes loop() when a window closes.
+class BandScanner {
+    public:
+        BandScanner( LOTuner *lo, AudioMeter *meter );
+        void startScan( uint64_t fromLo, TaskHandle_t notify );         // Whole band, builds the station list
+        void startSeek( uint64_t fromLo, int8_t direction, TaskHandle_t notify );  // Next station up (1) or down (-1)
+        void abort();
+        bool busy() { return _mode != SCAN_IDLE; }
+        bool step();                    // Call when the meter's window is ready, returns true when finished
+        uint64_t loFreq() { return _lo; }   // Where the LO is now, the result once finished
+        uint8_t stationCount() { return _numStations; }
+        const ScanStation *station( uint8_t index ) { return &_stations[index]; }
+        void dump( Print *out );
+
+    private:
+        void measure( uint64_t station );
+        uint8_t readQuality();
+        void addStation( uint64_t station, uint8_t quality );
+        bool nextCandidate();
+        bool nextFinePoint();
+        uint64_t nextSeekStation();
+        bool finish( uint64_t station );
+
+        LOTuner *_tuner;
+        AudioMeter *_meter;
+        TaskHandle_t _notify;
+        uint8_t _mode;
+        uint64_t _lo;
+        uint64_t _station;              // Station frequency being measured
+
+        uint8_t _coarse[SCAN_COARSE_POINTS];
+        uint8_t _index;                 // Coarse point, or candidate during the fine pass
+        uint8_t _fineStep;              // 0: below the candidate, 1: above
+        uint8_t _best;                  // Best quality around the current candidate / seek peak
+        uint64_t _bestStation;
+
+        int8_t _direction;
+        uint64_t _startStation;         // Where to go back to if nothing is found
+        uint16_t _seekSteps;
+        bool _seekArmed;                // Below threshold at the start station or since leaving it
+
+        ScanStation _stations[SCAN_MAX_STATIONS];
+        uint8_t _numStations;
+        uint16_t _channels;             // Measured in the last scan or seek
+        uint32_t _startTime;            // millis()
+        uint32_t _elapsed;
+};
+
+#endif
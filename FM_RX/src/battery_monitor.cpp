@@ -0,0 +1,53 @@
+#include <battery_monitor.h>
+
+BatteryMonitor::BatteryMonitor(uint8_t enPin, uint8_t adcPin)
+{
+    _enPin = enPin;
+    _adcPin = adcPin;
+    _filtered = 0;
+    _published = 0;
+}
+
+bool BatteryMonitor::begin()
+{
+    uint16_t mv = measure();
+    _filtered = (uint32_t)mv << BAT_FILTER_SHIFT;
+    _published = mv;
+    return xTaskCreatePinnedToCore(sampleTask, "battery", BAT_TASK_STACK, this, BAT_TASK_PRIORITY, NULL, BAT_TASK_CORE) == pdPASS;
+}
+
+// One oversampled reading of the battery in mV. analogReadMilliVolts() applies
+// the eFuse ADC calibration, which the old raw * 3.3 / 4095 conversion didn't.
+uint16_t BatteryMonitor::measure()
+{
+    uint32_t sum = 0;
+    digitalWrite(_enPin, HIGH);
+    vTaskDelay(pdMS_TO_TICKS(BAT_SETTLE_MS));
+    for (uint8_t i = 0; i < BAT_OVERSAMPLE; i++)
+    {
+        sum += analogReadMilliVolts(_adcPin);
+    }
+    digitalWrite(_enPin, LOW);
+    return BAT_DIVIDER * sum / BAT_OVERSAMPLE;
+}
+
+void BatteryMonitor::sample()
+{
+    _filtered += measure() - (_filtered >> BAT_FILTER_SHIFT);
+
+    uint16_t mv = _filtered >> BAT_FILTER_SHIFT;
+    if (mv >= _published + BAT_HYSTERESIS_MV || mv + BAT_HYSTERESIS_MV <= _published)
+    {
+        _published = mv;
+    }
+}
+
+void BatteryMonitor::sampleTask(void *param)
+{
+    BatteryMonitor *monitor = (BatteryMonitor *)param;
+    while (1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(BAT_SAMPLE_INTERVAL));
+        monitor->sample();
+    }
+}
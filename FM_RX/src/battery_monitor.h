@@ -0,0 +1,37 @@
+#ifndef BATTERY_MONITOR_h
+#define BATTERY_MONITOR_h
+
+#include <Arduino.h>
+
+#define BAT_SAMPLE_INTERVAL 1000    // ms between measurements
+#define BAT_SETTLE_MS       1       // Divider settling time after BAT_ADC_EN goes high
+#define BAT_OVERSAMPLE      16      // Readings averaged per measurement
+#define BAT_FILTER_SHIFT    2       // IIR filter, each measurement moves the estimate 1/4 of the way
+#define BAT_HYSTERESIS_MV   15      // Published value only moves when the estimate drifts this far
+#define BAT_DIVIDER         2       // Resistor divider ratio in front of BAT_ADC
+
+#define BAT_TASK_CORE       0
+#define BAT_TASK_PRIORITY   0       // Idle priority, runs whenever core 0 has nothing better to do
+#define BAT_TASK_STACK      2048
+
+// Samples the battery from its own task so the UI path never waits on the
+// ADC. The divider is only powered while a burst of readings is taken.
+class BatteryMonitor {
+    public:
+        BatteryMonitor( uint8_t enPin, uint8_t adcPin );
+        bool begin();                   // Takes the first reading synchronously, then starts the task
+        uint16_t millivolts() { return _published; }
+        uint16_t centivolts() { return (_published + 5) / 10; }
+
+    private:
+        uint16_t measure();
+        void sample();
+        static void sampleTask( void *param );
+
+        uint8_t _enPin;
+        uint8_t _adcPin;
+        uint32_t _filtered;             // mV << BAT_FILTER_SHIFT
+        volatile uint16_t _published;   // mV, what the UI reads
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include <control_bench.h>
+
+struct BenchStep {
+    uint8_t action;
+    int8_t detents;
+};
+
+// Every step is undone by a later one so the radio ends up where it started
+static const BenchStep BENCH_SCRIPT[] = {
+    { BENCH_TUNE, 1 },
+    { BENCH_TUNE, -1 },
+    { BENCH_TUNE, 5 },      // Fast spin, several detents in one pass
+    { BENCH_TUNE, -5 },
+    { BENCH_VOLUME, -1 },
+    { BENCH_VOLUME, 1 },
+    { BENCH_EQ, 1 },
+    { BENCH_EQ, -1 },
+    { BENCH_OUTPUT, 1 },
+    { BENCH_OUTPUT, 1 }
+};
+
+static const char *const BENCH_ACTION_NAMES[BENCH_NUM_ACTIONS] = {
+    "tune",
+    "volume",
+    "eq",
+    "output"
+};
+
+static uint32_t samples[BENCH_NUM_ACTIONS][BENCH_MAX_SAMPLES];
+static uint16_t sample_count[BENCH_NUM_ACTIONS];
+
+static void sortSamples(uint32_t *data, uint16_t count)
+{
+    // Insertion sort, a few hundred entries at most
+    for (uint16_t i = 1; i < count; i++)
+    {
+        uint32_t value = data[i];
+        uint16_t j = i;
+        while (j > 0 && data[j - 1] > value)
+        {
+            data[j] = data[j - 1];
+            j--;
+        }
+        data[j] = value;
+    }
+}
+
+void runControlBenchmark(Print *out, BenchInjectFn inject, BenchPassFn pass)
+{
+    uint32_t cpu_mhz = getCpuFrequencyMhz();
+    uint8_t eq_band = 0;
+
+    memset(sample_count, 0, sizeof(sample_count));
+    pass();     // Settle anything already pending
+
+    for (uint16_t r = 0; r < BENCH_REPEATS; r++)
+    {
+        for (uint8_t s = 0; s < sizeof(BENCH_SCRIPT) / sizeof(BENCH_SCRIPT[0]); s++)
+        {
+            const BenchStep *step = &BENCH_SCRIPT[s];
+            delay(BENCH_GAP_MS);
+
+            inject(step->action, step->detents, step->action == BENCH_EQ ? eq_band : 0);
+            uint32_t start = ESP.getCycleCount();
+            pass();
+            uint32_t cycles = ESP.getCycleCount() - start;
+
+            if (sample_count[step->action] < BENCH_MAX_SAMPLES)
+            {
+                samples[step->action][sample_count[step->action]++] = cycles;
+            }
+        }
+        eq_band = (eq_band + 1) % 5;
+    }
+
+    out->printf("Control path latency, %u passes @ %u MHz (us)\n", BENCH_REPEATS, cpu_mhz);
+    out->printf("action      n      p50      p99      max\n");
+    for (uint8_t a = 0; a < BENCH_NUM_ACTIONS; a++)
+    {
+        uint16_t n = sample_count[a];
+        if (!n)
+        {
+            continue;
+        }
+        sortSamples(samples[a], n);
+        out->printf("%-8s %4u %8u %8u %8u\n", BENCH_ACTION_NAMES[a], n,
+                    samples[a][n / 2] / cpu_mhz,
+                    samples[a][(n * 99) / 100] / cpu_mhz,
+                    samples[a][n - 1] / cpu_mhz);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef CONTROL_BENCH_h
+#define CONTROL_BENCH_h
+
+#include <Arduino.h>
+
+#define BENCH_REPEATS       50  // Passes over the script
+#define BENCH_MAX_SAMPLES   200 // Per action, enough for BENCH_REPEATS of the script
+#define BENCH_GAP_MS        20  // Idle time between steps so the display task can drain
+
+// Control actions the script can replay
+enum BenchAction {
+    BENCH_TUNE,         // ROT1 detents
+    BENCH_VOLUME,       // ROT2 on the volume page
+    BENCH_EQ,           // ROT2 on an EQ page, cycles through the five bands
+    BENCH_OUTPUT,       // ROT2 on the output page (toggles SPK/AUX)
+    BENCH_NUM_ACTIONS
+};
+
+// inject() puts one scripted input where the control path will see it, pass()
+// runs one pass of that path (not loop() itself, which would re-enter the
+// serial handler that started the benchmark). Latency is measured across
+// pass() with the CPU cycle counter and reported as p50/p99/max per action.
+typedef void (*BenchInjectFn)(uint8_t action, int8_t detents, uint8_t index);
+typedef void (*BenchPassFn)();
+
+void runControlBenchmark( Print *out, BenchInjectFn inject, BenchPassFn pass );
+
+#endif
@@ -0,0 +1,478 @@
+#include <display_ui.h>
+#include <param_menu.h>
+
+// Field layout, text size 1 is 6x8 pixels per character. The caret box is
+// only 6 rows tall so clearing it doesn't eat into the Bat line at y = 16.
+// Parameter fields bring their own boxes.
+static const UIFieldBox UI_BOXES[UI_NUM_FIXED] = {
+    { 0, 0, 66, 8 },        // UI_FREQ   " 96.300 MHz"
+    { 0, 10, 42, 6 },       // UI_CARET  "     ^"
+    { 0, 16, 54, 8 },       // UI_BAT    "Bat: 3.70"
+    { 100, 0, 18, 8 },      // UI_LO     "PLL"
+    { 0, 57, 76, 7 }        // UI_METER  signal quality bar, under Out:
+};
+
+DisplayUI::DisplayUI(Adafruit_SSD1306 *display, TwoWire *i2c_wire, uint8_t addr)
+{
+    _display = display;
+    _wire = i2c_wire;
+    _addr = addr;
+    _lock = NULL;
+    _task = NULL;
+    _panel = UI_PANEL_STARTING;
+    _readyAt = 0;
+    _params = NULL;
+    _numParams = 0;
+    for (uint8_t page = 0; page < UI_PAGES; page++)
+    {
+        _pendingStart[page] = 0xFF;
+        _pendingEnd[page] = 0;
+        _dirtyStart[page] = 0xFF;
+        _dirtyEnd[page] = 0;
+    }
+    invalidate();
+}
+
+// The panel init sequence goes out from the flush task, so the rest of
+// setup() doesn't wait on it. If the task can't be started the panel is
+// brought up here instead.
+bool DisplayUI::begin()
+{
+    _lock = xSemaphoreCreateMutex();
+    if (_lock && xTaskCreatePinnedToCore(flushTask, "display", UI_TASK_STACK, this, UI_TASK_PRIORITY, &_task, UI_TASK_CORE) == pdPASS)
+    {
+        return true;
+    }
+    _task = NULL;   // update() falls back to flushing inline
+    startPanel();
+    return false;
+}
+
+// Wire has to be running already, the Adafruit driver isn't allowed to
+// begin() the bus again underneath the other devices
+bool DisplayUI::startPanel()
+{
+    bool ok;
+    {
+        I2CProfileScope profile(I2C_SITE_DISPLAY_INIT, _addr);
+        ok = _display->begin(SSD1306_SWITCHCAPVCC, _addr, true, false);
+    }
+    if (ok)
+    {
+        _display->setTextSize(1);
+        _display->setTextColor(SSD1306_WHITE);
+        _display->cp437(true);
+    }
+    _readyAt = micros();
+    __atomic_store_n(&_panel, ok ? UI_PANEL_OK : UI_PANEL_MISSING, __ATOMIC_RELEASE);
+    return ok;
+}
+
+uint8_t DisplayUI::waitReady(uint32_t timeoutMs)
+{
+    uint32_t start = millis();
+    while (panelState() == UI_PANEL_STARTING && millis() - start < timeoutMs)
+    {
+        vTaskDelay(1);
+    }
+    return panelState();
+}
+
+void DisplayUI::flushTask(void *param)
+{
+    DisplayUI *ui = (DisplayUI *)param;
+    if (!ui->startPanel())
+    {
+        vTaskDelete(NULL);  // Nothing to drive, update() won't wake this task
+    }
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        ui->flush();
+    }
+}
+
+// Widens a page's column range to cover start..end
+static void mergeRange(uint8_t *range_start, uint8_t *range_end, uint8_t start, uint8_t end)
+{
+    if (*range_start > *range_end)
+    {   // Page was clean
+        *range_start = start;
+        *range_end = end;
+    }
+    else
+    {
+        *range_start = min(*range_start, start);
+        *range_end = max(*range_end, end);
+    }
+}
+
+void DisplayUI::invalidate()
+{
+    _valid = false;
+}
+
+void DisplayUI::setParams(const ParamDesc *table, uint8_t count)
+{
+    _params = table;
+    _numParams = min(count, (uint8_t)UI_MAX_PARAMS);
+    invalidate();
+}
+
+const UIFieldBox *DisplayUI::fieldBox(uint8_t field)
+{
+    return field < UI_NUM_FIXED ? &UI_BOXES[field] : &_params[field - UI_NUM_FIXED].box;
+}
+
+// True if the selection highlight moved on or off the given page
+static bool selectionChanged(const UIState *a, const UIState *b, uint8_t param)
+{
+    return (a->selected_param == param) != (b->selected_param == param);
+}
+
+bool DisplayUI::fieldChanged(uint8_t field, const UIState *state)
+{
+    if (!_valid)
+    {
+        return true;
+    }
+
+    switch (field)
+    {
+    case UI_FREQ:
+        return state->tuned_freq != _shown.tuned_freq;
+    case UI_CARET:
+        return state->freq_digit != _shown.freq_digit;
+    case UI_BAT:
+        return state->bat_centivolts != _shown.bat_centivolts;
+    case UI_LO:
+        return state->lo_select != _shown.lo_select;
+    case UI_METER:
+        return state->signal_quality != _shown.signal_quality;
+    default:    // Parameter pages
+    {
+        uint8_t param = field - UI_NUM_FIXED;
+        return state->params[param] != _shown.params[param] || selectionChanged(state, &_shown, param);
+    }
+    }
+}
+
+void DisplayUI::printLabel(const char *label, bool selected)
+{
+    if (selected)
+    {
+        _display->setTextColor(SSD1306_BLACK, SSD1306_WHITE);
+    }
+    _display->print(label);
+    if (selected)
+    {
+        _display->setTextColor(SSD1306_WHITE, SSD1306_BLACK);
+    }
+    _display->print(F(" "));
+}
+
+void DisplayUI::renderField(uint8_t field, const UIState *state)
+{
+    const UIFieldBox *box = fieldBox(field);
+    _display->fillRect(box->x, box->y, box->w, box->h, SSD1306_BLACK);
+    _display->setTextColor(SSD1306_WHITE);
+    _display->setCursor(box->x, box->y);
+
+    switch (field)
+    {
+    case UI_FREQ:
+    {
+        // Integer formatting so 1 kHz steps print exactly
+        uint32_t khz = (uint32_t)(state->tuned_freq / 1000);
+        uint16_t frac = khz % 1000;
+        if (khz < 100000)
+        {
+            _display->print(F(" "));
+        }
+        _display->print(khz / 1000);
+        _display->print(frac < 100 ? (frac < 10 ? F(".00") : F(".0")) : F("."));
+        _display->print(frac);
+        _display->print(F(" MHz"));
+        break;
+    }
+
+    case UI_CARET:
+        _display->print(F(" "));
+        // To consider decimal point
+        if (state->freq_digit > 1)
+        {
+            _display->print(F(" "));
+        }
+        for (uint8_t i = 0; i < state->freq_digit; i++)
+        {
+            _display->print(F(" "));
+        }
+        _display->print(F("^"));
+        break;
+
+    case UI_BAT:
+        _display->print(F("Bat: "));
+        _display->print(state->bat_centivolts / 100);
+        _display->print(state->bat_centivolts % 100 < 10 ? F(".0") : F("."));
+        _display->print(state->bat_centivolts % 100);
+        break;
+
+    case UI_LO:
+        if (state->lo_select) {
+            _display->print(F("PLL"));
+        }
+        else {
+            _display->print(F("EXT"));
+        }
+        break;
+
+    case UI_METER:
+    {
+        // Outline plus a fill proportional to the quality score
+        int16_t fill = (int32_t)(box->w - 2) * state->signal_quality / 100;
+        _display->drawRect(box->x, box->y, box->w, box->h, SSD1306_WHITE);
+        _display->fillRect(box->x + 1, box->y + 1, fill, box->h - 2, SSD1306_WHITE);
+        break;
+    }
+
+    default:    // Parameter pages, drawn from their table entry
+    {
+        uint8_t index = field - UI_NUM_FIXED;
+        const ParamDesc *param = &_params[index];
+        int8_t value = state->params[index];
+        printLabel(param->label, state->selected_param == index);
+        if (param->choices) {
+            _display->print(param->choices[value - param->min]);
+        }
+        else {
+            _display->print(param->shownBase + param->shownScale * value);
+        }
+        break;
+    }
+    }
+}
+
+void DisplayUI::markDirty(const UIFieldBox *box)
+{
+    int16_t last_col = box->x + box->w - 1;
+    if (last_col >= UI_WIDTH)
+    {
+        last_col = UI_WIDTH - 1;
+    }
+    for (uint8_t page = box->y / 8; page <= (box->y + box->h - 1) / 8 && page < UI_PAGES; page++)
+    {
+        mergeRange(&_pendingStart[page], &_pendingEnd[page], box->x, last_col);
+    }
+}
+
+// Copies the pending regions of the back buffer into the front buffer and
+// wakes the flush task. If the task is mid-transfer the regions stay pending
+// and go out with the next update, so loop() never blocks on the panel.
+bool DisplayUI::handoff()
+{
+    if (_lock && xSemaphoreTake(_lock, 0) != pdTRUE)
+    {
+        return false;
+    }
+
+    const uint8_t *back = _display->getBuffer();
+    for (uint8_t page = 0; page < UI_PAGES; page++)
+    {
+        if (_pendingStart[page] <= _pendingEnd[page])
+        {
+            uint16_t offset = page * UI_WIDTH + _pendingStart[page];
+            memcpy(&_front[offset], &back[offset], _pendingEnd[page] - _pendingStart[page] + 1);
+            mergeRange(&_dirtyStart[page], &_dirtyEnd[page], _pendingStart[page], _pendingEnd[page]);
+            _pendingStart[page] = 0xFF;
+            _pendingEnd[page] = 0;
+        }
+    }
+
+    if (_lock)
+    {
+        xSemaphoreGive(_lock);
+    }
+    if (_task)
+    {
+        xTaskNotifyGive(_task);
+    }
+    else
+    {
+        flush();
+    }
+    return true;
+}
+
+uint8_t DisplayUI::update(const UIState *state)
+{
+    uint8_t redrawn = 0;
+
+    // No framebuffer until the panel is up, the first update after that
+    // draws the whole screen
+    if (panelState() != UI_PANEL_OK)
+    {
+        return 0;
+    }
+
+    if (!_valid)
+    {
+        _display->clearDisplay();
+        for (uint8_t page = 0; page < UI_PAGES; page++)
+        {
+            _pendingStart[page] = 0;
+            _pendingEnd[page] = UI_WIDTH - 1;
+        }
+    }
+
+    for (uint8_t field = 0; field < UI_NUM_FIXED + _numParams; field++)
+    {
+        if (fieldChanged(field, state))
+        {
+            renderField(field, state);
+            markDirty(fieldBox(field));
+            redrawn++;
+        }
+    }
+
+    _shown = *state;
+    _valid = true;
+
+    for (uint8_t page = 0; page < UI_PAGES; page++)
+    {
+        if (_pendingStart[page] <= _pendingEnd[page])
+        {
+            handoff();
+            break;
+        }
+    }
+    return redrawn;
+}
+
+// Sends only the dirty part of the front buffer. Runs of consecutive dirty
+// pages go out as one window using the union of their column ranges, which
+// saves the addressing overhead of a window per page.
+void DisplayUI::flush()
+{
+    I2CProfileScope profile(I2C_SITE_DISPLAY_FLUSH);
+    uint32_t sent_at;   // micros() at the start of the current transaction
+
+    if (_lock)
+    {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+    }
+
+    uint8_t page = 0;
+
+    while (page < UI_PAGES)
+    {
+        if (_dirtyStart[page] > _dirtyEnd[page])
+        {
+            page++;
+            continue;
+        }
+
+        uint8_t first = page;
+        uint8_t start = _dirtyStart[page];
+        uint8_t end = _dirtyEnd[page];
+        while (page + 1 < UI_PAGES && _dirtyStart[page + 1] <= _dirtyEnd[page + 1])
+        {
+            page++;
+            start = min(start, _dirtyStart[page]);
+            end = max(end, _dirtyEnd[page]);
+        }
+
+        // Set the column/page window, horizontal addressing wraps inside it
+        sent_at = micros();
+        _wire->beginTransmission(_addr);
+        _wire->write((uint8_t)0x00);    // Co = 0, D/C = 0: command stream
+        _wire->write((uint8_t)SSD1306_COLUMNADDR);
+        _wire->write(start);
+        _wire->write(end);
+        _wire->write((uint8_t)SSD1306_PAGEADDR);
+        _wire->write(first);
+        _wire->write(page);
+        endTransmission(7, sent_at);
+
+        uint8_t count = 0;
+        for (uint8_t p = first; p <= page; p++)
+        {
+            const uint8_t *row = &_front[p * UI_WIDTH];
+            for (uint16_t col = start; col <= end; col++)
+            {
+                if (count == 0)
+                {
+                    sent_at = micros();
+                    _wire->beginTransmission(_addr);
+                    _wire->write((uint8_t)0x40);    // Co = 0, D/C = 1: data stream
+                }
+                _wire->write(row[col]);
+                if (++count == UI_I2C_CHUNK)
+                {
+                    endTransmission(count + 1, sent_at);
+                    count = 0;
+                }
+            }
+            _dirtyStart[p] = 0xFF;
+            _dirtyEnd[p] = 0;
+        }
+        if (count)
+        {
+            endTransmission(count + 1, sent_at);
+        }
+        page++;
+    }
+
+    if (_lock)
+    {
+        xSemaphoreGive(_lock);
+    }
+}
+
+// Contrast and on/off go out as one command stream while holding the front
+// buffer lock. Sent from loop() through the Adafruit driver they were separate
+// transactions, and a flush on core 0 could put its window command in between
+// SETCONTRAST and its value.
+uint8_t DisplayUI::setPower(uint8_t level)
+{
+    if (panelState() != UI_PANEL_OK)
+    {
+        return 0;
+    }
+
+    I2CProfileScope profile(I2C_SITE_DISPLAY_POWER, _addr);
+    if (_lock)
+    {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+    }
+
+    uint32_t sent_at = micros();
+    uint8_t bytes;
+    _wire->beginTransmission(_addr);
+    _wire->write((uint8_t)0x00);    // Co = 0, D/C = 0: command stream
+    if (level == UI_POWER_OFF)
+    {
+        _wire->write((uint8_t)SSD1306_DISPLAYOFF);
+        bytes = 2;
+    }
+    else
+    {
+        _wire->write((uint8_t)SSD1306_SETCONTRAST);
+        _wire->write((uint8_t)(level == UI_POWER_DIM ? 0 : UI_CONTRAST));
+        _wire->write((uint8_t)SSD1306_DISPLAYON);
+        bytes = 4;
+    }
+    uint8_t err = endTransmission(bytes, sent_at);
+
+    if (_lock)
+    {
+        xSemaphoreGive(_lock);
+    }
+    return err;
+}
+
+uint8_t DisplayUI::endTransmission(uint16_t bytes, uint32_t sent_at)
+{
+    uint8_t err = _wire->endTransmission();
+    i2c_profiler.transaction(_addr, bytes, err, micros() - sent_at);
+    return err;
+}
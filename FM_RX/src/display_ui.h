@@ -0,0 +1,105 @@
+#ifndef DISPLAY_UI_h
+#define DISPLAY_UI_h
+
+#include <Wire.h>
+#include <Adafruit_SSD1306.h>
+#include <i2c_profiler.h>
+
+#define UI_WIDTH        128
+#define UI_PAGES        8   // 64 rows / 8 rows per SSD1306 page
+#define UI_I2C_CHUNK    64  // Data bytes per I2C transaction when streaming a window
+
+#define UI_TASK_CORE        0       // Arduino loop() runs on core 1, the panel gets the other one
+#define UI_TASK_PRIORITY    1
+#define UI_TASK_STACK       3072
+
+#define UI_MAX_PARAMS       12      // ROT2 pages the screen can carry, see param_menu.h
+
+// Panel bring-up progress, see DisplayUI::panelState()
+#define UI_PANEL_STARTING   0
+#define UI_PANEL_OK         1
+#define UI_PANEL_MISSING    2
+
+// Panel power levels, see DisplayUI::setPower()
+#define UI_POWER_ON         0
+#define UI_POWER_DIM        1       // Minimum contrast
+#define UI_POWER_OFF        2
+#define UI_CONTRAST         0xCF    // What the Adafruit driver sets for SSD1306_SWITCHCAPVCC
+
+struct ParamDesc;
+
+// Everything the screen shows, filled in by loop() each pass
+struct UIState {
+    uint64_t tuned_freq;        // Station frequency in Hz (LO + IF)
+    uint8_t freq_digit;
+    uint16_t bat_centivolts;    // Battery voltage in 10 mV steps
+    int8_t params[UI_MAX_PARAMS];   // ROT2 page values, in parameter table order
+    uint8_t selected_param;
+    uint8_t lo_select;
+    uint8_t signal_quality;     // 0 - 100 from the audio meter
+};
+
+enum UIField {
+    UI_FREQ,
+    UI_CARET,
+    UI_BAT,
+    UI_LO,
+    UI_METER,
+    UI_NUM_FIXED    // Parameter fields follow, one per table entry
+};
+
+// Screen area owned by a field, it gets cleared before the field is redrawn
+struct UIFieldBox {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+};
+
+class DisplayUI {
+    public:
+        DisplayUI( Adafruit_SSD1306 *display, TwoWire *i2c_wire, uint8_t addr );
+        bool begin();                           // Starts the flush task, which brings the panel up, call after Wire.begin()
+        uint8_t panelState() { return __atomic_load_n(&_panel, __ATOMIC_ACQUIRE); }
+        uint8_t waitReady( uint32_t timeoutMs );    // Blocks until the panel is up or found missing, returns panelState()
+        uint32_t readyTime() { return _readyAt; }   // micros() when bring-up finished
+        void setParams( const ParamDesc *table, uint8_t count );   // Table the params[] in UIState refer to
+        void invalidate();                      // Redraw and resend everything on the next update
+        uint8_t update( const UIState *state ); // Returns how many fields were redrawn, never waits on the bus
+        uint8_t setPower( uint8_t level );      // UI_POWER_*, waits for a running flush, returns the Wire error
+
+    private:
+        bool startPanel();
+        bool fieldChanged( uint8_t field, const UIState *state );
+        void renderField( uint8_t field, const UIState *state );
+        void printLabel( const char *label, bool selected );
+        const UIFieldBox *fieldBox( uint8_t field );
+        void markDirty( const UIFieldBox *box );
+        bool handoff();
+        void flush();
+        uint8_t endTransmission( uint16_t bytes, uint32_t sent_at );
+        static void flushTask( void *param );
+
+        Adafruit_SSD1306 *_display;
+        TwoWire *_wire;
+        uint8_t _addr;
+        UIState _shown;         // What is currently on the panel
+        const ParamDesc *_params;
+        uint8_t _numParams;
+        bool _valid;            // False until the first full frame has been drawn
+
+        // The Adafruit framebuffer is the back buffer loop() renders into. Dirty
+        // regions get copied into the front buffer, which only the flush task
+        // streams to the panel.
+        uint8_t _front[UI_WIDTH * UI_PAGES];
+        uint8_t _pendingStart[UI_PAGES];    // Back buffer columns per page not yet handed off, start > end when clean
+        uint8_t _pendingEnd[UI_PAGES];
+        uint8_t _dirtyStart[UI_PAGES];      // Front buffer columns per page not yet on the panel
+        uint8_t _dirtyEnd[UI_PAGES];
+        SemaphoreHandle_t _lock;            // Guards _front and _dirty*
+        TaskHandle_t _task;
+        uint8_t _panel;                     // UI_PANEL_*, update() draws nothing until it is OK
+        uint32_t _readyAt;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include <encoder_accel.h>
+
+// At 200 ms a steady 20 detents/s reaches x2, a fast spin x10
+static const AccelLevel ACCEL_LEVELS[ACCEL_NUM_LEVELS] = {
+    { 0, 1 },
+    { 4, 2 },
+    { 8, 5 },
+    { 14, 10 }
+};
+
+EncoderAccel::EncoderAccel()
+{
+    reset();
+}
+
+void EncoderAccel::reset()
+{
+    memset(_times, 0, sizeof(_times));
+    memset(_detents, 0, sizeof(_detents));
+    _head = 0;
+    _direction = 0;
+    _multiplier = 1;
+}
+
+int64_t EncoderAccel::delta(int64_t detents, int64_t step, uint32_t now)
+{
+    if (detents == 0)
+    {
+        return 0;
+    }
+
+    int8_t direction = detents > 0 ? 1 : -1;
+    if (direction != _direction)
+    {
+        reset();
+        _direction = direction;
+    }
+
+    uint64_t magnitude = detents > 0 ? detents : -detents;
+    _times[_head] = now;
+    _detents[_head] = magnitude > 0xFF ? 0xFF : magnitude;
+    _head = (_head + 1) % ACCEL_HISTORY;
+
+    // Everything still in the window, this pass included
+    uint16_t recent = 0;
+    for (uint8_t i = 0; i < ACCEL_HISTORY; i++)
+    {
+        if (_detents[i] && now - _times[i] < ACCEL_WINDOW_MS)
+        {
+            recent += _detents[i];
+        }
+    }
+
+    _multiplier = 1;
+    for (uint8_t level = 0; level < ACCEL_NUM_LEVELS; level++)
+    {
+        if (recent >= ACCEL_LEVELS[level].detents)
+        {
+            _multiplier = ACCEL_LEVELS[level].multiplier;
+        }
+    }
+
+    // The 1 MHz digit is already coarse, the multiplier can't push past it
+    int64_t scaled = step * _multiplier;
+    if (scaled > ACCEL_MAX_STEP)
+    {
+        scaled = step > ACCEL_MAX_STEP ? step : ACCEL_MAX_STEP;
+        _multiplier = scaled / step;
+    }
+    return detents * scaled;
+}
@@ -0,0 +1,36 @@
+#ifndef ENCODER_ACCEL_h
+#define ENCODER_ACCEL_h
+
+#include <Arduino.h>
+
+#define ACCEL_WINDOW_MS     200     // Knob speed is the number of detents seen in this window
+#define ACCEL_HISTORY       16      // Loop passes remembered, older ones fall out of the window anyway
+#define ACCEL_MAX_STEP      1000000 // Hz, a flick never moves more than this per detent
+#define ACCEL_NUM_LEVELS    4
+
+// Detents per window needed for each multiplier, slowest first
+struct AccelLevel {
+    uint8_t detents;
+    uint8_t multiplier;
+};
+
+// Scales tuning knob movement by how fast it is being turned. Slow turns
+// step by exactly the selected digit so fine tuning behaves as before, a
+// quick spin covers the band in a few dozen detents. Reversing direction
+// drops straight back to single steps.
+class EncoderAccel {
+    public:
+        EncoderAccel();
+        int64_t delta( int64_t detents, int64_t step, uint32_t now );  // Frequency change in Hz for this pass's detents
+        uint8_t multiplier() { return _multiplier; }                   // Used by the last delta()
+        void reset();
+
+    private:
+        uint32_t _times[ACCEL_HISTORY];     // millis() of each pass that moved the knob
+        uint8_t _detents[ACCEL_HISTORY];    // How far it moved that pass, saturated
+        uint8_t _head;
+        int8_t _direction;
+        uint8_t _multiplier;
+};
+
+#endif
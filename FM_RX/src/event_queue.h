@@ -0,0 +1,72 @@
+#ifndef EVENT_QUEUE_h
+#define EVENT_QUEUE_h
+
+#include <Arduino.h>
+
+#define EVENT_QUEUE_SIZE 32     // Power of two
+
+// Inputs the ISRs hand over to loop(). Knob turns don't carry a count, loop()
+// reads the encoder counters when it handles them.
+enum ControlEventType {
+    EVENT_ROT1_TURN,
+    EVENT_ROT2_TURN,
+    EVENT_ROT1_PRESS,
+    EVENT_ROT1_RELEASE,
+    EVENT_ROT2_PRESS,
+    EVENT_BUT1_PRESS,
+    EVENT_DISPLAY_TICK
+};
+
+struct ControlEvent {
+    uint8_t type;
+    uint32_t time;      // millis() when it was posted
+};
+
+// Single-producer/single-consumer ring buffer. Neither side takes a lock, the
+// head and tail indices are each written by one side only and published with
+// release/acquire ordering so the slot contents are visible before the index.
+template <typename T, uint8_t SIZE>
+class SPSCQueue {
+    static_assert(SIZE && !(SIZE & (SIZE - 1)), "SPSCQueue size must be a power of two");
+
+    public:
+        SPSCQueue() : _head(0), _tail(0), _dropped(0) {}
+
+        // Producer side, returns false and counts a drop when full
+        bool push( const T &item )
+        {
+            uint8_t head = _head;
+            uint8_t next = (head + 1) & (SIZE - 1);
+            if (next == __atomic_load_n(&_tail, __ATOMIC_ACQUIRE))
+            {
+                _dropped++;
+                return false;
+            }
+            _items[head] = item;
+            __atomic_store_n(&_head, next, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        // Consumer side
+        bool pop( T *item )
+        {
+            uint8_t tail = _tail;
+            if (tail == __atomic_load_n(&_head, __ATOMIC_ACQUIRE))
+            {
+                return false;
+            }
+            *item = _items[tail];
+            __atomic_store_n(&_tail, (uint8_t)((tail + 1) & (SIZE - 1)), __ATOMIC_RELEASE);
+            return true;
+        }
+
+        uint32_t dropped() { return _dropped; }
+
+    private:
+        T _items[SIZE];
+        uint8_t _head;      // Next slot to write, owned by the producer
+        uint8_t _tail;      // Next slot to read, owned by the consumer
+        uint32_t _dropped;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include <i2c_profiler.h>
+
+I2CProfiler i2c_profiler;
+
+static const char *const I2C_SITE_NAMES[I2C_NUM_SITES] = {
+    "other",
+    "codec.begin",
+    "setSpeakerVolume",
+    "setALCGain",
+    "setEQGain",
+    "setOutput",
+    "setPLL",
+    "setClocking",
+    "codec.dsp",
+    "display.begin",
+    "display.flush",
+    "display.power",
+    "pll.init",
+    "pll.set_freq",
+    "pll.output_enable",
+    "pll.update_status"
+};
+
+I2CProfiler::I2CProfiler()
+{
+    portMUX_INITIALIZE(&_mux);
+    reset();
+}
+
+void I2CProfiler::reset()
+{
+    portENTER_CRITICAL(&_mux);
+    _current[0] = I2C_SITE_OTHER;
+    _current[1] = I2C_SITE_OTHER;
+    memset(_addrs, 0, sizeof(_addrs));
+    memset(_devices, 0, sizeof(_devices));
+    memset(_sites, 0, sizeof(_sites));
+    _resetTime = millis();
+    portEXIT_CRITICAL(&_mux);
+}
+
+// Stats slot for an address, claims a free one the first time it's seen.
+// Must be called inside the critical section.
+I2CStats *I2CProfiler::device(uint8_t addr)
+{
+    for (uint8_t i = 0; i < I2C_PROFILE_DEVICES; i++)
+    {
+        if (_addrs[i] == addr)
+        {
+            return &_devices[i];
+        }
+        if (_addrs[i] == 0)
+        {
+            _addrs[i] = addr;
+            return &_devices[i];
+        }
+    }
+    return NULL;
+}
+
+void I2CProfiler::transaction(uint8_t addr, uint16_t bytes, uint8_t err, uint32_t us)
+{
+    portENTER_CRITICAL(&_mux);
+    I2CStats *dev = device(addr);
+    I2CStats *site = &_sites[_current[xPortGetCoreID() & 1]];
+    if (dev)
+    {
+        dev->transactions++;
+        dev->bytes += bytes;
+        dev->nacks += err ? 1 : 0;
+        dev->us += us;
+    }
+    site->transactions++;
+    site->bytes += bytes;
+    site->nacks += err ? 1 : 0;
+    portEXIT_CRITICAL(&_mux);
+}
+
+void I2CProfiler::enterSite(uint8_t site, uint8_t *prevSite)
+{
+    portENTER_CRITICAL(&_mux);
+    uint8_t core = xPortGetCoreID() & 1;
+    *prevSite = _current[core];
+    _current[core] = site;
+    _sites[site].calls++;
+    portEXIT_CRITICAL(&_mux);
+}
+
+void I2CProfiler::exitSite(uint8_t site, uint8_t prevSite, uint8_t opaqueAddr, uint32_t us, bool sawTransactions)
+{
+    portENTER_CRITICAL(&_mux);
+    _current[xPortGetCoreID() & 1] = prevSite;
+    _sites[site].us += us;
+    if (opaqueAddr && !sawTransactions)
+    {   // Library call, only its duration is known
+        I2CStats *dev = device(opaqueAddr);
+        if (dev)
+        {
+            dev->us += us;
+        }
+    }
+    portEXIT_CRITICAL(&_mux);
+}
+
+uint32_t I2CProfiler::siteTransactions()
+{
+    portENTER_CRITICAL(&_mux);
+    uint32_t count = _sites[_current[xPortGetCoreID() & 1]].transactions;
+    portEXIT_CRITICAL(&_mux);
+    return count;
+}
+
+void I2CProfiler::dump(Print *out)
+{
+    // Copy out first so printing doesn't hold the lock
+    I2CStats devices[I2C_PROFILE_DEVICES];
+    I2CStats sites[I2C_NUM_SITES];
+    uint8_t addrs[I2C_PROFILE_DEVICES];
+    portENTER_CRITICAL(&_mux);
+    memcpy(devices, _devices, sizeof(devices));
+    memcpy(sites, _sites, sizeof(sites));
+    memcpy(addrs, _addrs, sizeof(addrs));
+    uint32_t elapsed = millis() - _resetTime;
+    portEXIT_CRITICAL(&_mux);
+
+    out->printf("I2C profile over %u ms\n", elapsed);
+    out->printf("addr   trans   bytes  nacks        us  busy%%\n");
+    for (uint8_t i = 0; i < I2C_PROFILE_DEVICES && addrs[i]; i++)
+    {
+        out->printf("0x%02X %7u %7u %6u %9u %5u\n", addrs[i], devices[i].transactions, devices[i].bytes,
+                    devices[i].nacks, devices[i].us, elapsed ? devices[i].us / 10 / elapsed : 0);
+    }
+    out->printf("site                 calls   trans   bytes  nacks        us\n");
+    for (uint8_t i = 0; i < I2C_NUM_SITES; i++)
+    {
+        if (sites[i].calls || sites[i].transactions)
+        {
+            out->printf("%-18s %7u %7u %7u %6u %9u\n", I2C_SITE_NAMES[i], sites[i].calls, sites[i].transactions,
+                        sites[i].bytes, sites[i].nacks, sites[i].us);
+        }
+    }
+}
+
+
+I2CProfileScope::I2CProfileScope(uint8_t site, uint8_t opaqueAddr)
+{
+    _site = site;
+    _opaqueAddr = opaqueAddr;
+    i2c_profiler.enterSite(site, &_prevSite);
+    _startTransactions = i2c_profiler.siteTransactions();
+    _start = micros();
+}
+
+I2CProfileScope::~I2CProfileScope()
+{
+    uint32_t us = micros() - _start;
+    bool saw = i2c_profiler.siteTransactions() != _startTransactions;
+    i2c_profiler.exitSite(_site, _prevSite, _opaqueAddr, us, saw);
+}
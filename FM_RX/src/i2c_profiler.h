@@ -0,0 +1,79 @@
+#ifndef I2C_PROFILER_h
+#define I2C_PROFILER_h
+
+#include <Arduino.h>
+
+#define I2C_PROFILE_DEVICES 4   // Distinct bus addresses tracked, NAU8810 + SSD1306 + Si5351 + spare
+
+// Call sites traffic gets attributed to
+enum I2CSite {
+    I2C_SITE_OTHER,
+    I2C_SITE_CODEC_INIT,
+    I2C_SITE_SET_SPEAKER_VOLUME,
+    I2C_SITE_SET_ALC_GAIN,
+    I2C_SITE_SET_EQ_GAIN,
+    I2C_SITE_SET_OUTPUT,
+    I2C_SITE_SET_PLL,
+    I2C_SITE_SET_CLOCKING,
+    I2C_SITE_SET_DSP,
+    I2C_SITE_DISPLAY_INIT,
+    I2C_SITE_DISPLAY_FLUSH,
+    I2C_SITE_DISPLAY_POWER,
+    I2C_SITE_PLL_INIT,
+    I2C_SITE_PLL_SET_FREQ,
+    I2C_SITE_PLL_OUTPUT_ENABLE,
+    I2C_SITE_PLL_STATUS,
+    I2C_NUM_SITES
+};
+
+struct I2CStats {
+    uint32_t calls;         // Times a site was entered (unused for devices)
+    uint32_t transactions;
+    uint32_t bytes;         // Payload bytes, not counting the address byte
+    uint32_t nacks;
+    uint32_t us;            // Time spent, including library calls we can't see inside
+};
+
+// Per-device and per-call-site bus counters. Drivers we own report each
+// transaction; calls into the Si5351 and SSD1306 libraries are wrapped in an
+// I2CProfileScope that charges their elapsed time to the device instead,
+// since their individual transactions aren't visible from here.
+class I2CProfiler {
+    public:
+        I2CProfiler();
+        void transaction( uint8_t addr, uint16_t bytes, uint8_t err, uint32_t us );
+        void enterSite( uint8_t site, uint8_t *prevSite );
+        void exitSite( uint8_t site, uint8_t prevSite, uint8_t opaqueAddr, uint32_t us, bool sawTransactions );
+        uint32_t siteTransactions();        // Transactions charged to the current site so far
+        void reset();
+        void dump( Print *out );
+
+    private:
+        I2CStats *device( uint8_t addr );
+
+        portMUX_TYPE _mux;                  // Display task and loop() report from different cores
+        uint8_t _current[2];                // Active site per core
+        uint8_t _addrs[I2C_PROFILE_DEVICES];
+        I2CStats _devices[I2C_PROFILE_DEVICES];
+        I2CStats _sites[I2C_NUM_SITES];
+        uint32_t _resetTime;
+};
+
+extern I2CProfiler i2c_profiler;
+
+// Attributes bus traffic inside a block to a call site. Pass the device
+// address when the block calls into a library that talks to the bus itself.
+class I2CProfileScope {
+    public:
+        I2CProfileScope( uint8_t site, uint8_t opaqueAddr = 0 );
+        ~I2CProfileScope();
+
+    private:
+        uint8_t _site;
+        uint8_t _prevSite;
+        uint8_t _opaqueAddr;
+        uint32_t _start;
+        uint32_t _startTransactions;
+};
+
+#endif
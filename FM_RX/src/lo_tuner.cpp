@@ -0,0 +1,131 @@
+#include <lo_tuner.h>
+
+LOTuner::LOTuner(Si5351 *pll)
+{
+    _pll = pll;
+    _fast = false;
+    _tableValid = false;
+}
+
+void LOTuner::begin()
+{
+    for (uint16_t i = 0; i < LO_NUM_CHANNELS; i++)
+    {
+        calcPLLRegs(LO_BAND_START - IF_FREQ + (uint64_t)i * LO_CHANNEL_STEP, _channelRegs[i]);
+    }
+    _tableValid = true;
+    invalidate();
+}
+
+// Table entry for an LO that lands a station on the channel raster, NULL otherwise
+const uint8_t *LOTuner::channelRegs(uint64_t freq)
+{
+    uint64_t station = freq + IF_FREQ;
+    if (!_tableValid || station < LO_BAND_START || station > LO_BAND_END)
+    {
+        return NULL;
+    }
+    uint32_t offset = (uint32_t)(station - LO_BAND_START);
+    if (offset % LO_CHANNEL_STEP)
+    {
+        return NULL;
+    }
+    return _channelRegs[offset / LO_CHANNEL_STEP];
+}
+
+void LOTuner::invalidate()
+{
+    _fast = false;
+}
+
+// PLL A feedback registers 28 - 33 (P1 and P2, P3 high nibble) for a VCO of
+// freq * LO_MS_DIV. The arithmetic is Etherkit's pll_calc() step for step
+// (Q31 ppb correction, truncated b), so a table entry matches what
+// set_freq_manual() programs for the same frequency down to the LSB. The one
+// difference is c staying LO_PLL_DENOM when b is 0, which is the same ratio.
+void LOTuner::calcPLLRegs(uint64_t freq, uint8_t *regs)
+{
+    // Everything in 0.01 Hz like the library
+    uint64_t ref = (uint64_t)_pll->xtal_freq[SI5351_PLL_INPUT_XO] * SI5351_FREQ_MULT;
+    int32_t correction = _pll->get_correction(SI5351_PLL_INPUT_XO);
+    ref = ref + (int32_t)((((((int64_t)correction) << 31) / 1000000000LL) * ref) >> 31);
+
+    uint64_t vco = freq * SI5351_FREQ_MULT * LO_MS_DIV;
+    uint32_t a = vco / ref;
+    uint32_t b = ((uint64_t)(vco % ref) * LO_PLL_DENOM) / ref;
+
+    uint32_t p1 = 128 * a + (128 * b) / LO_PLL_DENOM - 512;
+    uint32_t p2 = 128 * b - LO_PLL_DENOM * ((128 * (uint64_t)b) / LO_PLL_DENOM);
+
+    regs[0] = (p1 >> 16) & 0x03;
+    regs[1] = (p1 >> 8) & 0xFF;
+    regs[2] = p1 & 0xFF;
+    regs[3] = ((LO_PLL_DENOM >> 12) & 0xF0) | ((p2 >> 16) & 0x0F);
+    regs[4] = (p2 >> 8) & 0xFF;
+    regs[5] = p2 & 0xFF;
+}
+
+uint8_t LOTuner::fastRetune(uint64_t freq)
+{
+    uint8_t regs[6];
+    const uint8_t *image = channelRegs(freq);
+    if (!image)
+    {   // Off-raster (e.g. 1 kHz fine tuning), do the math now
+        calcPLLRegs(freq, regs);
+        image = regs;
+    }
+
+    // Registers 26/27 hold P3, which never changes, so start the burst at 28
+    uint32_t start = micros();
+    uint8_t err = _pll->si5351_write_bulk(SI5351_PLLA_PARAMETERS + 2, 6, (uint8_t *)image);
+    i2c_profiler.transaction(SI5351_BUS_BASE_ADDR, 7, err, micros() - start);
+    if (!err)
+    {
+        // Keep the library's view of PLL A in step for any later full retune
+        _pll->plla_freq = freq * SI5351_FREQ_MULT * LO_MS_DIV;
+        _pll->clk_freq[SI5351_CLK0] = freq * SI5351_FREQ_MULT;
+    }
+    return err;
+}
+
+uint8_t LOTuner::fullRetune(uint64_t freq)
+{
+    if (freq >= LO_FAST_MIN && freq <= LO_FAST_MAX)
+    {
+        // Park the multisynth on the integer divider and put the PLL where it needs to be
+        uint8_t err = _pll->set_freq_manual(freq * SI5351_FREQ_MULT, freq * SI5351_FREQ_MULT * LO_MS_DIV, SI5351_CLK0);
+        if (err)
+        {
+            _fast = false;
+            return err;
+        }
+
+        // The library writes P3 = 1 when the ratio comes out integer, and every
+        // fast retune after that would be off. Rewrite the whole PLL A block
+        // (26 - 33) against LO_PLL_DENOM so P3 is known from here on.
+        uint8_t regs[8];
+        regs[0] = (LO_PLL_DENOM >> 8) & 0xFF;
+        regs[1] = LO_PLL_DENOM & 0xFF;
+        calcPLLRegs(freq, regs + 2);
+        uint32_t start = micros();
+        err = _pll->si5351_write_bulk(SI5351_PLLA_PARAMETERS, 8, regs);
+        i2c_profiler.transaction(SI5351_BUS_BASE_ADDR, 9, err, micros() - start);
+        _fast = !err;
+        return err;
+    }
+
+    // Outside the fast window: back to the library's fixed 800 MHz PLL and fractional multisynth
+    _fast = false;
+    _pll->set_pll(SI5351_PLL_FIXED, SI5351_PLLA);
+    return _pll->set_freq(freq * SI5351_FREQ_MULT, SI5351_CLK0);
+}
+
+uint8_t LOTuner::setFrequency(uint64_t freq)
+{
+    I2CProfileScope profile(I2C_SITE_PLL_SET_FREQ, SI5351_BUS_BASE_ADDR);
+    if (_fast && freq >= LO_FAST_MIN && freq <= LO_FAST_MAX)
+    {
+        return fastRetune(freq);
+    }
+    return fullRetune(freq);
+}
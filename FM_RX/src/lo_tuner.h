@@ -0,0 +1,47 @@
+#ifndef LO_TUNER_h
+#define LO_TUNER_h
+
+#include <si5351.h>
+#include <i2c_profiler.h>
+
+#define LO_MS_DIV       8           // Even integer CLK0 multisynth divider used while fast tuning
+#define LO_PLL_DENOM    1048575     // PLL feedback denominator (c), fixed so fast retunes never rewrite P3
+#define LO_FAST_MIN     (SI5351_PLL_VCO_MIN / LO_MS_DIV)    // 75 MHz
+#define LO_FAST_MAX     (SI5351_PLL_VCO_MAX / LO_MS_DIV)    // 112.5 MHz, covers the whole FM band LO
+
+#define IF_FREQ         10700000ULL     // LO sits one IF below the station
+
+// Channel table covers the broadcast band on a 100 kHz raster, which also
+// holds every channel of the 200 kHz (odd tenths) raster
+#define LO_BAND_START       87500000ULL
+#define LO_BAND_END         108000000ULL
+#define LO_CHANNEL_STEP     100000
+#define LO_NUM_CHANNELS     ((LO_BAND_END - LO_BAND_START) / LO_CHANNEL_STEP + 1)   // 206
+
+// Drives CLK0 from PLL A. Inside LO_FAST_MIN..LO_FAST_MAX the multisynth is
+// parked on an integer divider and retuning only rewrites the PLL A feedback
+// P1/P2 registers in one 6-byte burst. Anything outside that window, or the
+// first tune, goes through the full Etherkit set_freq() path; entering the
+// window also rewrites P3, since the library drops c to 1 on integer ratios. Broadcast
+// channels come straight out of a register image table built at boot.
+class LOTuner {
+    public:
+        LOTuner( Si5351 *pll );
+        void begin();                           // Builds the channel table, call again after set_correction()
+        uint8_t setFrequency( uint64_t freq );  // LO freq in Hz, zero means success
+        void invalidate();                      // Next setFrequency() does a full retune
+        bool fastMode() { return _fast; }
+
+    private:
+        uint8_t fastRetune( uint64_t freq );
+        uint8_t fullRetune( uint64_t freq );
+        void calcPLLRegs( uint64_t freq, uint8_t *regs );
+        const uint8_t *channelRegs( uint64_t freq );
+
+        Si5351 *_pll;
+        bool _fast;         // CLK0 multisynth currently set to LO_MS_DIV
+        bool _tableValid;
+        uint8_t _channelRegs[LO_NUM_CHANNELS][6];   // PLL A registers 28 - 33 per channel
+};
+
+#endif
@@ -7,8 +7,24 @@
 #include <Adafruit_I2CDevice.h>
 #include <Adafruit_SSD1306.h>
 #include <nau8810.h>
+#include <display_ui.h>
+#include <lo_tuner.h>
+#include <i2c_profiler.h>
+#include <control_bench.h>
+#include <battery_monitor.h>
+#include <event_queue.h>
+#include <power_manager.h>
+#include <audio_pipeline.h>
+#include <audio_filters.h>
+#include <audio_clock.h>
+#include <audio_meter.h>
+#include <band_scanner.h>
+#include <settings_store.h>
+#include <encoder_accel.h>
+#include <param_menu.h>
 #include <driver/ledc.h>
 #include <driver/i2s.h>
+#include <esp_timer.h>
 
 // Pin definitions
 #define EXT_LO_EN 17
@@ -39,36 +55,96 @@
 #define SCREEN_HEIGHT 64
 #define OLED_RESET -1
 #define SCREEN_ADDR 0x3C
+#define I2C_CLOCK 400000    // Every device on the bus (SSD1306, NAU8810, Si5351) is rated for fast mode
+
+#define PLL_STATUS_INTERVAL 1000  // ms between Si5351 lock/status polls
+#define LOOP_IDLE_TIMEOUT 1000    // ms loop() sleeps at most when no events arrive
+#define DISPLAY_TICK_PERIOD 100000  // us between display refreshes (10 Hz)
+#define LONG_PRESS_TIME 600       // ms ROT1 has to be held to seek instead of changing digit
+#define BOOT_DISPLAY_TIMEOUT 100  // ms setup() waits at the end for the OLED bring-up on core 0
+#define SERIAL_ARG_TIMEOUT 2000   // ms a serial command waits for its argument character
+#define BOOT_MAX_PHASES 10
 
 #define NAU8810_ADDR 0x1A     // Datasheet says 34, but 7 bit address BS (ESP32 scanner found this)
 
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, I2C_CLOCK, I2C_CLOCK);
+DisplayUI ui(&display, &Wire, SCREEN_ADDR);
 
 NAU8810 audio_codec(NAU8810_ADDR, &Wire);
 int8_t volume = 30;  // max value 63
 int8_t alc = 15;  // Max value 15
-uint8_t audio_ctrl_state = 0;   // 0 for speaker gain, 1 for ALC gain
 int8_t eq_gain[5] = {0x0C, 0x0C, 0x0C, 0x0C, 0x0C};
-uint8_t audio_output = 0; // 0 for speaker, 1 for aux port
+int8_t audio_output = 0; // 0 for speaker, 1 for aux port
+
+// Past either end of its range the ALC knob also switches the DAC de-emphasis.
+// That switch is a step in the response, so it goes out muted; plain level
+// changes only wait for a zero crossing.
+uint8_t applyALC(NAU8810 *codec, int8_t value, int16_t requested)
+{
+  codec->beginTransaction(requested != value ? NAU_TXN_SOFT_MUTE | NAU_TXN_ZERO_CROSS : NAU_TXN_ZERO_CROSS);
+  if (requested > value) {
+    codec->updateRegister(NAU_DAC_CTRL_ADDR, NAU_DAC_DEEMP, NAU_DAC_CTRL_CMD);
+  }
+  else if (requested < value) {
+    codec->updateRegister(NAU_DAC_CTRL_ADDR, NAU_DAC_DEEMP, 0x0000);
+  }
+  codec->setALCGain(value);
+  return codec->commitTransaction();
+}
 
-volatile uint8_t DISPLAY_FLAG = 1; // Set when display needs to update
+const char *const OUTPUT_NAMES[] = { "SPK", "AUX" };
+
+// ROT2 pages in the order its button steps through them. EQ gain registers
+// count down (0 is +12 dB), so those knobs run backwards.
+enum ControlPage { PAGE_VOLUME, PAGE_ALC, PAGE_OUTPUT, PAGE_EQ1 };
+const ParamDesc CONTROL_PAGES[] = {
+  // label  value          min  max   step  kind          setter                                         shown   choices        box
+  { "Vol:", &volume,       0,   63,   1,    PARAM_RANGE,  codecSetter<&NAU8810::setSpeakerVolume>,       0, 1,   NULL,          { 0, 26, 48, 8 } },
+  { "ALC:", &alc,          0,   15,   1,    PARAM_RANGE,  applyALC,                                      0, 1,   NULL,          { 0, 36, 48, 8 } },
+  { "Out:", &audio_output, 0,   1,    1,    PARAM_TOGGLE, codecSetter<&NAU8810::setOutput>,              0, 1,   OUTPUT_NAMES,  { 0, 46, 48, 8 } },
+  { "EQ1:", &eq_gain[0],   0,   0x18, -1,   PARAM_RANGE,  codecBandSetter<&NAU8810::setEQGain, 1>,       12, -1, NULL,          { 80, 16, 48, 8 } },
+  { "EQ2:", &eq_gain[1],   0,   0x18, -1,   PARAM_RANGE,  codecBandSetter<&NAU8810::setEQGain, 2>,       12, -1, NULL,          { 80, 26, 48, 8 } },
+  { "EQ3:", &eq_gain[2],   0,   0x18, -1,   PARAM_RANGE,  codecBandSetter<&NAU8810::setEQGain, 3>,       12, -1, NULL,          { 80, 36, 48, 8 } },
+  { "EQ4:", &eq_gain[3],   0,   0x18, -1,   PARAM_RANGE,  codecBandSetter<&NAU8810::setEQGain, 4>,       12, -1, NULL,          { 80, 46, 48, 8 } },
+  { "EQ5:", &eq_gain[4],   0,   0x18, -1,   PARAM_RANGE,  codecBandSetter<&NAU8810::setEQGain, 5>,       12, -1, NULL,          { 80, 56, 48, 8 } },
+};
+ParamMenu<sizeof(CONTROL_PAGES) / sizeof(CONTROL_PAGES[0])> controls(CONTROL_PAGES, &audio_codec);
+
+uint8_t DISPLAY_FLAG = 1; // Set when display needs to update
 
 // TwoWire i2c_bus = TwoWire(0);
-volatile uint8_t freq_digit = 2;
-volatile int64_t freq_step = 100000; // Adjust this to control which digit is stepped with encoder (default 100 kHz)
+uint8_t freq_digit = 2;
+int64_t freq_step = 100000; // Adjust this to control which digit is stepped with encoder (default 100 kHz)
 uint64_t pll_freq = 85600000ULL;
+uint64_t lo_freq_applied = 0;  // Frequency last written to the Si5351, 0 forces a write
+uint32_t pll_status_time = 0;  // millis() of the last Si5351 status poll
 
+EncoderAccel tuning_accel;   // Scales freq_step by how fast ROT1 is spun
 int64_t rot1_count = 0;
 int64_t rot1_prev = 0;
 int64_t rot2_count = 0;
 int64_t rot2_prev = 0;
 
 Si5351 pll;
-
-ESP32Encoder rot1, rot2;
-
-volatile uint8_t LO_SELECT = 1; // 1 if using PLL for LO, 0 for EXT
-volatile uint8_t LO_CHANGE = 1; // 1 if LO has been changed, used to update LCD
+LOTuner lo(&pll);
+
+void ROT1_TURN_ISR(void *arg);
+void ROT2_TURN_ISR(void *arg);
+ESP32Encoder rot1(true, ROT1_TURN_ISR), rot2(true, ROT2_TURN_ISR);   // Interrupt on every count change
+
+uint8_t LO_SELECT = 1; // 1 if using PLL for LO, 0 for EXT
+uint8_t pll_present = 0;    // Si5351 answered at boot, without it only the external LO works
+uint8_t codec_present = 0;
+uint8_t LO_CHANGE = 1; // 1 if LO has been changed, used to update LCD
+
+// Everything the ISRs see goes through here, loop() is the only consumer and
+// owns the control state above
+SPSCQueue<ControlEvent, EVENT_QUEUE_SIZE> events;
+portMUX_TYPE event_mux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t loop_task = NULL;
+volatile uint8_t ROT1_TURN_PENDING = 0; // Set while a turn event is queued, so a fast spin doesn't flood the queue
+volatile uint8_t ROT2_TURN_PENDING = 0;
+volatile uint8_t DISPLAY_TICK_PENDING = 0;  // Raised by the display timer, turned into an event by loop()
 
 volatile uint32_t ROT1_DEBOUNCE, ROT2_DEBOUNCE, BUT1_DEBOUNCE;
 volatile uint8_t BUT1_STATE = 0; // 0 for not pressed, 1 for pressed
@@ -77,15 +153,83 @@ volatile uint8_t ROT2_STATE = 0; // 0 for not pressed, 1 for pressed
 uint32_t DEBOUNCE_TIME = 10;
 
 
-hw_timer_t *display_timer = NULL;
+esp_timer_handle_t display_timer = NULL;
+uint8_t display_ticking = 1;    // Display timer is stopped while the panel is off
+
+// First three have CHANGE interrupts attached, the encoder phases belong to PCNT
+const uint8_t WAKE_PINS[] = { ROT1_SW, ROT2_SW, BUT1, ROT1_A, ROT1_B, ROT2_A, ROT2_B };
+#define WAKE_EDGE_MASK 0x07
+PowerManager power(&ui);
 
-float batVoltage;
+BatteryMonitor battery(BAT_ADC_EN, BAT_ADC);
+AudioPipeline audio(I2S_NUM_0);
+AudioClock audio_clock(I2S_NUM_0, &audio_codec, &audio);   // I2S, codec clocks and pipeline format, always changed together
+AudioMeter meter;           // Measures the raw ADC blocks, ahead of the filters
+FilterChain audio_filter;   // 15 kHz low-pass, the pilot notch and de-emphasis run in the codec
+BandScanner scanner(&lo, &meter);
+uint32_t rot1_press_time = 0;   // millis() of the last ROT1 press
+uint8_t rot1_press_aborted = 0; // Press stopped a seek, its release does nothing
+int serial_arg_command = 0;     // Serial command still waiting for its argument character
+uint32_t serial_arg_time = 0;   // millis() when that command arrived
+
+SettingsStore store;
+RadioSettings settings;     // Snapshot of the globals above, compared against flash by the store
+StationPresets presets;
 
 // INTERRUPT FUNCTIONS
 
-// Called periodically to update LCD
-void IRAM_ATTR DISPLAY_TIMER_ISR() {
-  DISPLAY_FLAG = 1;
+// The GPIO and encoder ISRs are all level 1 on core 1, so they can't
+// preempt each other and together act as the queue's single producer
+void IRAM_ATTR postEventFromISR(uint8_t type)
+{
+  ControlEvent event = { type, millis() };
+  BaseType_t woken = pdFALSE;
+  events.push(event);
+  if (loop_task) {
+    vTaskNotifyGiveFromISR(loop_task, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+// Task-context producer, masks the ISRs above while it pushes
+void postEvent(uint8_t type)
+{
+  ControlEvent event = { type, millis() };
+  portENTER_CRITICAL(&event_mux);
+  events.push(event);
+  portEXIT_CRITICAL(&event_mux);
+  if (loop_task) {
+    xTaskNotifyGive(loop_task);
+  }
+}
+
+// Called periodically to update LCD. esp_timer rather than a hardware timer
+// because it keeps time when DFS drops the APB clock; the callback runs in
+// the esp_timer task on core 0, which isn't one of the queue's producers, so
+// it only raises a flag and wakes loop().
+void displayTick(void *)
+{
+  DISPLAY_TICK_PENDING = 1;
+  if (loop_task) {
+    xTaskNotifyGive(loop_task);
+  }
+}
+
+// Called by the encoder driver on every count change
+void IRAM_ATTR ROT1_TURN_ISR(void *)
+{
+  if (!ROT1_TURN_PENDING) {
+    ROT1_TURN_PENDING = 1;
+    postEventFromISR(EVENT_ROT1_TURN);
+  }
+}
+
+void IRAM_ATTR ROT2_TURN_ISR(void *)
+{
+  if (!ROT2_TURN_PENDING) {
+    ROT2_TURN_PENDING = 1;
+    postEventFromISR(EVENT_ROT2_TURN);
+  }
 }
 
 // Called when ROT1 switch is pressed or released (CHANGE)
@@ -98,30 +242,7 @@ void IRAM_ATTR ROT1_SW_ISR()
 
       ROT1_DEBOUNCE = millis();
       ROT1_STATE = 1;
-
-      // When ROT1 button is pressed, cycle through which digit is changed with freq knob
-      switch (freq_step)
-      {
-      case 1000000: // 1 MHz to 100 kHz
-        freq_step = 100000;
-        freq_digit = 2;
-        break;
-      case 100000: // 100 kHz to 10 kHz
-        freq_step = 10000;
-        freq_digit = 3;
-        break;
-      case 10000: // 10 kHz to 1 kHz
-        freq_step = 1000;
-        freq_digit = 4;
-        break;
-      case 1000: // 1 kHz to 1 MHz
-        freq_step = 1000000;
-        freq_digit = 1;
-        break;
-        //      default:      // Default to 100 kHz
-        //        freq_step = 100000;
-      }
-      DISPLAY_FLAG = 1;
+      postEventFromISR(EVENT_ROT1_PRESS);
     }
   }
   else
@@ -131,6 +252,7 @@ void IRAM_ATTR ROT1_SW_ISR()
 
       ROT1_DEBOUNCE = millis();
       ROT1_STATE = 0;
+      postEventFromISR(EVENT_ROT1_RELEASE);
     }
   }
 }   // End of ROT1 ISR
@@ -149,15 +271,7 @@ void IRAM_ATTR ROT2_SW_ISR()
 
       ROT2_DEBOUNCE = millis();
       ROT2_STATE = 1;
-
-
-      audio_ctrl_state++;
-      if (audio_ctrl_state > 7) {
-        audio_ctrl_state = 0;     
-      }
-
-
-      DISPLAY_FLAG = 1;
+      postEventFromISR(EVENT_ROT2_PRESS);
     }
   }
   else
@@ -184,34 +298,510 @@ void IRAM_ATTR BUTTON_ISR()
 
       BUT1_DEBOUNCE = millis();
       BUT1_STATE = 1;
+      postEventFromISR(EVENT_BUT1_PRESS);
+    }
+  }
+  else
+  { // If button not pressed
+    if (BUT1_STATE && (millis() - BUT1_DEBOUNCE >= DEBOUNCE_TIME))
+    {
+
+      BUT1_DEBOUNCE = millis();
+      BUT1_STATE = 0;
+    }
+  }
+}   // End of BUT1 ISR
+
+// EVENT HANDLING
+
+void setDisplayTicks(uint8_t enable)
+{
+  if (enable && !display_ticking) {
+    esp_timer_start_periodic(display_timer, DISPLAY_TICK_PERIOD);
+  }
+  else if (!enable && display_ticking) {
+    esp_timer_stop(display_timer);
+  }
+  display_ticking = enable;
+}
+
+// Sleep timer expired: mute, stop the audio clocks and the RF rail, and light
+// sleep until a knob or button is touched
+void enterStandby()
+{
+  Serial.println("Standby");
+  store.flush();    // Don't leave the last change waiting on a quiet period that may end in a dead battery
+  audio_codec.updateRegister(NAU_DAC_CTRL_ADDR, NAU_DAC_SOFTMUTE, NAU_DAC_SOFTMUTE);
+  i2s_stop(I2S_NUM_0);
+  digitalWrite(RF_EN, LOW);
+
+  power.standby();
+
+  digitalWrite(RF_EN, digitalRead(TOGGLE1));
+  i2s_start(I2S_NUM_0);
+  audio_codec.updateRegister(NAU_DAC_CTRL_ADDR, NAU_DAC_SOFTMUTE, 0);
+  setDisplayTicks(1);
+  DISPLAY_FLAG = 1;
+}
+
+// BOOT TIMING
+
+struct BootPhase {
+  const char *name;
+  uint32_t us;      // micros() when the phase finished, counted from reset
+};
+BootPhase boot_phases[BOOT_MAX_PHASES];
+uint8_t boot_num_phases = 0;
+
+void bootPhase(const char *name)
+{
+  if (boot_num_phases < BOOT_MAX_PHASES) {
+    boot_phases[boot_num_phases].name = name;
+    boot_phases[boot_num_phases].us = micros();
+    boot_num_phases++;
+  }
+}
+
+// Anything printed before the USB host opens the port is lost, so the
+// report can be asked for again with 't'
+void printBootTimes()
+{
+  uint32_t prev = 0;
+  for (uint8_t i = 0; i < boot_num_phases; i++) {
+    Serial.print(boot_phases[i].name);
+    Serial.print(": ");
+    Serial.print(boot_phases[i].us);
+    Serial.print(" us (+");
+    Serial.print(boot_phases[i].us - prev);
+    Serial.println(")");
+    prev = boot_phases[i].us;
+  }
+  if (ui.panelState() == UI_PANEL_OK) {
+    Serial.print("display (core 0): ");
+    Serial.print(ui.readyTime());
+    Serial.println(" us");
+  }
+}
+
+// AUDIO
+
+// Runs again from AudioClock with the pipeline parked whenever the sample
+// rate changes. Below 38 kHz the 19 kHz pilot is past Nyquist and the
+// codec's decimation filter has already removed it. Above that the codec's
+// ADC notch takes it out for free; the software notch only comes back if
+// the codec can't be reached.
+void designAudioFilters(uint32_t sample_rate, void *)
+{
+  BiquadCoeffs coeffs;
+  audio_filter.clear();
+  if (sample_rate > 2 * 19000) {
+    if (!codec_present || audio_codec.setNotch(sample_rate, 19000, 19000 / 8)) {
+      designNotch(&coeffs, sample_rate, 19000, 8.0);
+      audio_filter.addSection(&coeffs);
+    }
+  }
+  else if (codec_present) {
+    audio_codec.disableNotch();
+  }
+  designLowPass(&coeffs, sample_rate, min(15000.0f, sample_rate * 0.45f), 0.7071);
+  audio_filter.addSection(&coeffs);
+}
+
+// Swaps between the full quality format and the low power one
+void toggleAudioClock()
+{
+  const AudioClockConfig *next = audio_clock.config()->sampleRate == AUDIO_CLOCK_QUALITY.sampleRate ?
+                                 &AUDIO_CLOCK_LOW_POWER : &AUDIO_CLOCK_QUALITY;
+  uint8_t err = audio_clock.set(next);
+  if (err) {
+    Serial.print("Audio clock change failed: ");
+    Serial.println(err);
+  }
+  Serial.print("Audio ");
+  Serial.print(audio_clock.config()->sampleRate);
+  Serial.print(" Hz ");
+  Serial.print(audio_clock.config()->bitsPerSample);
+  Serial.println("-bit");
+}
+
+// Seek and scan move the Si5351 themselves, keep loop()'s view in step
+void syncScanFreq()
+{
+  pll_freq = scanner.loFreq();
+  lo_freq_applied = pll_freq;
+  DISPLAY_FLAG = 1;
+}
+
+void stopScan()
+{
+  if (scanner.busy()) {
+    scanner.abort();
+    syncScanFreq();
+  }
+}
+
+// The scanner measures through the pipeline's meter, without it (no codec,
+// or stuck on the codec loopback) no window ever closes
+bool scanAllowed()
+{
+  if (!LO_SELECT || !pll_present) {
+    Serial.println("Seek/scan needs the PLL LO");
+    return false;
+  }
+  if (!audio.running()) {
+    Serial.println("Seek/scan needs the audio pipeline");
+    return false;
+  }
+  return true;
+}
+
+void startSeek(int8_t direction)
+{
+  if (scanAllowed()) {
+    scanner.startSeek(pll_freq, direction, loop_task);
+    syncScanFreq();
+  }
+}
+
+void startScan()
+{
+  if (scanAllowed()) {
+    scanner.startScan(pll_freq, loop_task);
+    syncScanFreq();
+  }
+}
+
+// SETTINGS
+
+void captureSettings(RadioSettings *out)
+{
+  out->pll_freq = pll_freq;
+  out->volume = volume;
+  out->alc = alc;
+  memcpy(out->eq_gain, eq_gain, sizeof(eq_gain));
+  out->audio_output = audio_output;
+  if (pll_present) {   // EXT forced by a missing Si5351 shouldn't outlive the fault
+    out->lo_select = LO_SELECT;
+  }
+}
+
+bool stationInBand(uint64_t station)
+{
+  return station >= LO_BAND_START && station <= LO_BAND_END;
+}
+
+// Takes a stored value for a control only if it is within that control's
+// limits in CONTROL_PAGES, otherwise the default stays
+void restoreParam(int8_t *value, int8_t stored)
+{
+  for (uint8_t i = 0; i < controls.size(); i++) {
+    const ParamDesc *param = &controls.table()[i];
+    if (param->value == value && stored >= param->min && stored <= param->max) {
+      *value = stored;
+    }
+  }
+}
+
+// Loads the last saved state over the defaults above, out of range values
+// (a corrupt or hand-edited blob) fall back to the default
+void restoreSettings()
+{
+  captureSettings(&settings);
+  settings.lo_select = LO_SELECT;
+  uint8_t loaded = store.begin(&settings, &presets);
+
+  // A station outside the band would send the LO somewhere it can't lock
+  uint8_t dropped = 0;
+  for (uint8_t slot = 0; slot < SETTINGS_NUM_PRESETS; slot++) {
+    if (presets.freq[slot] && !stationInBand(presets.freq[slot])) {
+      presets.freq[slot] = 0;
+      dropped++;
+    }
+  }
+  if (dropped) {
+    Serial.print("Dropped ");
+    Serial.print(dropped);
+    Serial.println(" out of band presets");
+  }
+
+  if (!(loaded & SETTINGS_LOADED_RADIO)) {
+    Serial.println("No saved settings, using defaults");
+    return;
+  }
+
+  restoreParam(&volume, settings.volume);
+  restoreParam(&alc, settings.alc);
+  for (uint8_t band = 0; band < 5; band++) {
+    restoreParam(&eq_gain[band], settings.eq_gain[band]);
+  }
+  restoreParam(&audio_output, settings.audio_output);
+  LO_SELECT = settings.lo_select ? 1 : 0;
+  if (stationInBand(settings.pll_freq + IF_FREQ)) {
+    pll_freq = settings.pll_freq;
+  }
+  captureSettings(&settings);
+}
+
+// Tunes to a stored station, the LO is moved by the next loop() pass
+void recallPreset(uint8_t slot)
+{
+  if (!stationInBand(presets.freq[slot])) {
+    Serial.println("Preset empty");
+    return;
+  }
+  stopScan();
+  pll_freq = presets.freq[slot] - IF_FREQ;
+  DISPLAY_FLAG = 1;
+}
+
+void storePreset(uint8_t slot)
+{
+  presets.freq[slot] = pll_freq + IF_FREQ;
+  Serial.print("Preset ");
+  Serial.print(slot + 1);
+  Serial.print(" = ");
+  Serial.println((uint32_t)(pll_freq + IF_FREQ));
+}
+
+// Applies one queued input to the control state, runs in loop()
+void handleEvent(const ControlEvent *event)
+{
+  if (event->type != EVENT_DISPLAY_TICK && power.activity()) {
+    setDisplayTicks(1);
+    DISPLAY_FLAG = 1;
+  }
+
+  switch (event->type) {
+    case EVENT_ROT1_TURN:
+      ROT1_TURN_PENDING = 0;    // Count is read after the queue is drained
+      stopScan();               // Manual tuning takes over from wherever the seek got to
+      break;
+
+    case EVENT_ROT2_TURN:
+      ROT2_TURN_PENDING = 0;
+      break;
 
+    case EVENT_ROT1_PRESS:
+      rot1_press_time = event->time;
+      rot1_press_aborted = scanner.busy();
+      stopScan();
+      break;
+
+    case EVENT_ROT1_RELEASE:
+      if (rot1_press_aborted) {
+        break;
+      }
+      if (event->time - rot1_press_time >= LONG_PRESS_TIME) {
+        startSeek(1);   // Long press seeks up
+        break;
+      }
+      // When ROT1 button is pressed, cycle through which digit is changed with freq knob
+      switch (freq_step)
+      {
+      case 1000000: // 1 MHz to 100 kHz
+        freq_step = 100000;
+        freq_digit = 2;
+        break;
+      case 100000: // 100 kHz to 10 kHz
+        freq_step = 10000;
+        freq_digit = 3;
+        break;
+      case 10000: // 10 kHz to 1 kHz
+        freq_step = 1000;
+        freq_digit = 4;
+        break;
+      case 1000: // 1 kHz to 1 MHz
+        freq_step = 1000000;
+        freq_digit = 1;
+        break;
+        //      default:      // Default to 100 kHz
+        //        freq_step = 100000;
+      }
+      DISPLAY_FLAG = 1;
+      break;
+
+    case EVENT_ROT2_PRESS:
+      controls.next();
+      DISPLAY_FLAG = 1;
+      break;
+
+    case EVENT_BUT1_PRESS:
       // Toggle which source the LO signal comes from (PLL or external)
+      if (!pll_present) {
+        break;
+      }
       LO_SELECT = !LO_SELECT;
       LO_CHANGE = 1;
       digitalWrite(EXT_LO_EN, LO_SELECT);
       digitalWrite(PLL_LO_EN, !LO_SELECT);
       digitalWrite(LED1, LO_SELECT); // LED1 turns on when PLL is used as LO
+      DISPLAY_FLAG = 1;
+      break;
 
+    case EVENT_DISPLAY_TICK:
       DISPLAY_FLAG = 1;
-      
+      break;
+  }
+}
+
+// One pass of the control path: queued inputs, seek/scan, power states, the
+// LO, codec and display. loop() runs it after each wake-up and the benchmark
+// times it directly, so it must not wait for anything or read Serial.
+void controlStep()
+{
+  ControlEvent event;
+  while (events.pop(&event)) {
+    handleEvent(&event);
+  }
+  if (DISPLAY_TICK_PENDING) {
+    DISPLAY_TICK_PENDING = 0;
+    ControlEvent tick = { EVENT_DISPLAY_TICK, millis() };
+    handleEvent(&tick);
+  }
+
+  // Seek/scan: the meter wakes this task when a channel's window closes
+  if (scanner.busy() && meter.windowReady()) {
+    if (scanner.step()) {
+      scanner.dump(&Serial);
     }
+    syncScanFreq();
   }
-  else
-  { // If button not pressed
-    if (BUT1_STATE && (millis() - BUT1_DEBOUNCE >= DEBOUNCE_TIME))
+
+  // Dim and blank the panel as the radio sits untouched. There's nothing to
+  // refresh with the panel off, so the display tick stops too.
+  uint8_t power_state = power.update();
+  if (power_state >= POWER_DISPLAY_OFF) {
+    setDisplayTicks(0);
+  }
+  if (power_state == POWER_STANDBY) {
+    enterStandby();
+  }
+
+  // Low-rate Si5351 health check
+  if (pll_present && millis() - pll_status_time >= PLL_STATUS_INTERVAL) {
+    pll_status_time = millis();
     {
+      I2CProfileScope profile(I2C_SITE_PLL_STATUS, SI5351_BUS_BASE_ADDR);
+      pll.update_status();
+    }
+    if (pll.dev_status.LOL_A || pll.dev_status.LOS) {
+      Serial.println("Si5351 PLL A lost lock");
+    }
+  }
 
-      BUT1_DEBOUNCE = millis();
-      BUT1_STATE = 0;
+  rot1_count = rot1.getCount(); // Controls PLL frequency
+  rot2_count = rot2.getCount(); // Controls volume?
+
+  if (rot1_count != rot1_prev || rot2_count != rot2_prev || DISPLAY_FLAG)
+  {
+    // Change PLL settings. All detents since the last pass arrive as one
+    // count, so a burst costs a single LO update below however fast it was.
+    int64_t tune_delta = tuning_accel.delta(rot1_count - rot1_prev, freq_step, millis());
+    if (tune_delta) {
+      int64_t tuned = (int64_t)(pll_freq + IF_FREQ) + tune_delta;
+      if (tuning_accel.multiplier() > 1) {   // An accelerated spin stops at the band edge instead of flying past it
+        tuned = constrain(tuned, (int64_t)LO_BAND_START, (int64_t)LO_BAND_END);
+      }
+      pll_freq = tuned - IF_FREQ;
+    }
+
+    if (LO_CHANGE && pll_present) {
+      I2CProfileScope profile(I2C_SITE_PLL_OUTPUT_ENABLE, SI5351_BUS_BASE_ADDR);
+      pll.output_enable(SI5351_CLK0, LO_SELECT);
+      LO_CHANGE = 0;
+    }
+
+    // Only touch the Si5351 when the LO actually has to move, display refreshes and
+    // volume knob turns leave it alone. While EXT is selected the PLL just catches
+    // up once it is switched back in.
+    if (LO_SELECT && pll_present && pll_freq != lo_freq_applied) {
+      lo.setFrequency(pll_freq);   // Small in-band steps only rewrite the PLL fractional registers
+      //pll.set_freq(pll_freq * 100, SI5351_CLK1);
+      lo_freq_applied = pll_freq;
+    }
+
+    //Serial.println(pll_freq);
+    // rot1_prev = rot1_count;
+    rot1_prev = 0;
+    rot1.clearCount();
+
+
+    // Update audio codec, the selected page decides what the knob changes
+    if (rot2_count != rot2_prev) {
+      controls.turn(rot2_count - rot2_prev);
+      rot2_prev = 0;
+      rot2.clearCount();
     }
+
+
+
+    // Only the fields that changed get redrawn and sent to the panel
+    UIState ui_state;
+    ui_state.tuned_freq = pll_freq + IF_FREQ;
+    ui_state.freq_digit = freq_digit;
+    ui_state.bat_centivolts = battery.centivolts();   // Cached, sampled in the background
+    controls.snapshot(ui_state.params);
+    ui_state.selected_param = controls.selected();
+    ui_state.lo_select = LO_SELECT;
+    ui_state.signal_quality = meter.quality();
+    ui.update(&ui_state);
+    DISPLAY_FLAG = 0;
   }
-}   // End of BUT1 ISR
+
+  // Cheap compare every pass, flash is only written once things settle
+  captureSettings(&settings);
+  store.update(&settings, &presets);
+}
+
+// BENCHMARK HOOKS
+
+// Puts one scripted control input where the next controlStep() picks it up
+void benchInject(uint8_t action, int8_t detents, uint8_t index)
+{
+  switch (action) {
+    case BENCH_TUNE:
+      rot1.setCount(rot1.getCount() + detents);
+      postEvent(EVENT_ROT1_TURN);
+      break;
+    case BENCH_VOLUME:
+      controls.select(PAGE_VOLUME);
+      rot2.setCount(rot2.getCount() + detents);
+      postEvent(EVENT_ROT2_TURN);
+      break;
+    case BENCH_EQ:
+      controls.select(PAGE_EQ1 + index);
+      rot2.setCount(rot2.getCount() + detents);
+      postEvent(EVENT_ROT2_TURN);
+      break;
+    case BENCH_OUTPUT:
+      controls.select(PAGE_OUTPUT);
+      rot2.setCount(rot2.getCount() + detents);
+      postEvent(EVENT_ROT2_TURN);
+      break;
+  }
+}
+
+// Replays the control script and prints latency stats, leaves the radio as it was
+void runBenchmark()
+{
+  uint8_t saved_page = controls.selected();
+  runControlBenchmark(&Serial, benchInject, controlStep);
+  controls.select(saved_page);
+  DISPLAY_FLAG = 1;
+}
 
 void setup()
 {
 
   setCpuFrequencyMhz(80); // Lower power draw
 
+  Serial.begin(115200);
+  Serial.setTxTimeoutMs(0);   // Never wait on a USB host that isn't listening
+  bootPhase("start");
+
+  restoreSettings();  // Before anything below acts on the globals
+  bootPhase("settings");
+
   // Pin initializations
   pinMode(EXT_LO_EN, OUTPUT);
   pinMode(PLL_LO_EN, OUTPUT);
@@ -237,362 +827,245 @@ void setup()
   // digitalWrite( EXT_LO_EN, digitalRead(TOGGLE1) );
   // digitalWrite( PLL_LO_EN, !digitalRead(TOGGLE1) );
 
-  attachInterrupt(ROT1_SW, ROT1_SW_ISR, CHANGE);
-  attachInterrupt(ROT2_SW, ROT2_SW_ISR, CHANGE);
-  attachInterrupt(BUT1, BUTTON_ISR, CHANGE);
-
-  // Initialize timer0 with 80 prescale (80 MHz / 80 = 1 MHz)
-  display_timer = timerBegin(0, 80, true);
-  timerAttachInterrupt(display_timer, DISPLAY_TIMER_ISR, true);
-  timerAlarmWrite(display_timer, 100000, true);   // Call ISR every 100,000 counts (10 times / second)
-  timerAlarmEnable(display_timer);
-
   digitalWrite(EXT_LO_EN, LO_SELECT);
   digitalWrite(PLL_LO_EN, !LO_SELECT);
   digitalWrite(LED1, LO_SELECT); // LED1 turns on when PLL is used as LO
 
   // digitalWrite( LED1, HIGH);
-  digitalWrite(RF_EN, digitalRead(TOGGLE1)); // Enable 5V RF rail
+  digitalWrite(RF_EN, digitalRead(TOGGLE1)); // Enable 5V RF rail, it settles while everything else comes up
 
-  Serial.begin(115200);
-  Serial.setTxTimeoutMs(0);
-
-  delay(1000);
-  Serial.println("Hello world");
-
-  Wire.setPins(I2C_SDA, I2C_SCL);
-
-  const i2s_config_t i2s_config = {
-    .mode = i2s_mode_t(I2S_MODE_MASTER | I2S_MODE_RX),
-    .sample_rate = 48000,
-    .bits_per_sample = i2s_bits_per_sample_t(24),
-    .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-    .communication_format = i2s_comm_format_t(I2S_COMM_FORMAT_STAND_I2S),
-    .intr_alloc_flags = 0,
-    .dma_buf_count = 8,
-    .dma_buf_len = 8,
-    .use_apll = true,
-    .mclk_multiple = I2S_MCLK_MULTIPLE_384
-  };
- 
-  i2s_driver_install(I2S_NUM_0, &i2s_config, 0, NULL);
-
-
-    // Set I2S pin configuration
+  // MCLK goes first so the codec has a clock by the time it is configured
   const i2s_pin_config_t pin_config = {
     .mck_io_num = MCLK,
     .bck_io_num = I2S_BCLK,
     .ws_io_num = I2S_FS,
-    .data_out_num = -1,
+    .data_out_num = NAU_DACIN,
     .data_in_num = NAU_ADCOUT
   };
- 
-  i2s_set_pin(I2S_NUM_0, &pin_config);
+  bool i2s_started = !audio_clock.begin(&AUDIO_CLOCK_QUALITY, &pin_config);
+  if (!i2s_started) {
+    Serial.println("Failed to start I2S");
+  }
+  bootPhase("i2s");
+
+  // The OLED init sequence goes out from the display task on core 0 while
+  // the codec and Si5351 are set up here, the bus lock interleaves them
+  Wire.begin(I2C_SDA, I2C_SCL, I2C_CLOCK);
+  ui.setParams(controls.table(), controls.size());
+  if (!ui.begin()) {
+    Serial.println("Failed to start display task, flushing from loop()");
+  }
 
-  i2s_start(I2S_NUM_0);
-  
-  
+  uint8_t codec_failed_entry;
+  codec_present = !audio_codec.begin(&codec_failed_entry);
+  if (!codec_present) {
+    Serial.print("Failed to intialize audio codec at init entry ");
+    Serial.println(codec_failed_entry);
+  }
+  else {
+    // IMCLK, filter rate and word length follow whatever I2S is running
+    NAU8810PLLConfig codec_pll;
+    if (audio_clock.configureCodec(&codec_pll)) {
+      Serial.println("No codec clock setting for this MCLK");
+    }
+    else if (codec_pll.n) {
+      Serial.print("Codec PLL error ");
+      Serial.print(codec_pll.errorPpb);
+      Serial.println(" ppb");
+    }
 
-  if (audio_codec.begin()) {
-    Serial.println("Failed to intialize audio codec");
-    while(1) 
-    {
+    // Restored settings go to the codec as one burst of register writes
+    audio_codec.beginStaging();
+    controls.applyAll();
+    audio_codec.setDACLimiter(true);    // Catches EQ boosts at -1 dBFS instead of clipping
+    uint8_t codec_failed_reg;
+    if (audio_codec.commitStaged(&codec_failed_reg)) {
+      Serial.print("Failed to restore codec settings at register 0x");
+      Serial.println(codec_failed_reg, HEX);
     }
   }
-  Serial.println(audio_codec.setPLL(5000000));
-  audio_codec.setSpeakerVolume(volume);
-  audio_codec.setALCGain(alc);
-  audio_codec.setOutput(audio_output);
-  Serial.println(audio_codec.readRegister(NAU_ALC2_CTRL_ADDR), HEX);
-  Serial.println(audio_codec.readRegister(NAU_POWER2_ADDR), HEX);
+  bootPhase("codec");
 
-  if (!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDR))
   {
-    Serial.println("Failed to initialize OLED");
-    while (1)
-    {
-    };
-  }
-  Serial.println("Hello world");
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  display.cp437(true);
-
-  if (!pll.init(SI5351_CRYSTAL_LOAD_10PF, 0, 0))
-  { // Add 3.9 pF caps on either side of oscillator to make load capacitance 12 (10 + 4/2)
-    Serial.println("Failed to initialize Si5351");
-    while (1)
-    {
-    };
+    I2CProfileScope profile(I2C_SITE_PLL_INIT, SI5351_BUS_BASE_ADDR);
+    pll_present = pll.init(SI5351_CRYSTAL_LOAD_10PF, 0, 0); // Add 3.9 pF caps on either side of oscillator to make load capacitance 12 (10 + 4/2)
+    if (pll_present) {
+      pll.drive_strength(SI5351_CLK0, SI5351_DRIVE_2MA);
+      pll.set_correction(-215*100, SI5351_PLL_INPUT_XO);           // Set this to the difference in frequency from CLK2 and 100 MHz (in 0.01 Hz increments)
+    }
+  }
+  if (pll_present) {
+    lo.begin();   // Channel table depends on the correction above
+    lo.setFrequency(pll_freq);
+    lo_freq_applied = pll_freq;
+  }
+  else {
+    // Still usable with a signal generator on the external LO input
+    Serial.println("Failed to initialize Si5351, using external LO");
+    LO_SELECT = 0;
+    digitalWrite(EXT_LO_EN, LO_SELECT);
+    digitalWrite(PLL_LO_EN, !LO_SELECT);
+    digitalWrite(LED1, LO_SELECT);
   }
-
-  pll.drive_strength(SI5351_CLK0, SI5351_DRIVE_2MA);
-  pll.set_correction(-215*100, SI5351_PLL_INPUT_XO);           // Set this to the difference in frequency from CLK2 and 100 MHz (in 0.01 Hz increments)
-  pll.set_freq(pll_freq * 100, SI5351_CLK0);
 
   
   //pll.drive_strength(SI5351_CLK2, SI5351_DRIVE_2MA);
   //pll.set_freq(10000000ULL*100, SI5351_CLK2);             // Output desired 100 MHz on CLK2 for PLL calibration
   //pll.update_status();
-  Serial.println("Hello world");
-
-  rot1.attachSingleEdge(ROT1_A, ROT1_B);
-  rot2.attachSingleEdge(ROT2_A, ROT2_B);
-
-  rot1.clearCount();
-  rot2.clearCount();
-}
-
-void loop()
-{
-
-  rot1_count = rot1.getCount(); // Controls PLL frequency
-  rot2_count = rot2.getCount(); // Controls volume?
-
-  if (rot1_count != rot1_prev || rot2_count != rot2_prev || DISPLAY_FLAG)
-  {
-    // Change PLL settings
-    pll_freq = (rot1_count - rot1_prev) * freq_step + pll_freq;
-    pll.set_freq(pll_freq * 100, SI5351_CLK0);
-    //pll.set_freq(pll_freq * 100, SI5351_CLK1);
-    pll.update_status();
-
-    if (LO_CHANGE) {
-      pll.output_enable(SI5351_CLK0, LO_SELECT);
-      LO_CHANGE = 0;
-    }
-
-    //Serial.println(pll_freq);
-    // rot1_prev = rot1_count;
-    rot1_prev = 0;
-    rot1.clearCount();
-
+  bootPhase("si5351");
+
+  // The DAC is fed from the ESP32 once the pipeline runs, otherwise the codec
+  // keeps its internal ADC-to-DAC loopback
+  designAudioFilters(audio.sampleRate(), NULL);
+  audio_clock.setHook(designAudioFilters, NULL);
+  audio.addStage(AudioMeter::stage, &meter);
+  audio.addStage(FilterChain::stage, &audio_filter);
+
+  // Without the I2S driver the task would have nothing to block on
+  if (codec_present && i2s_started && audio.begin()) {
+    audio_codec.updateRegister(NAU_ADC_LOOPBACK_ADDR, NAU_ADC_LOOPBACK_CMD, 0);
+  }
+  else if (codec_present) {
+    Serial.println("Failed to start audio pipeline, using codec loopback");
+  }
+  bootPhase("audio");
 
-    // Update audio codec
-    if (rot2_count != rot2_prev) {
-      switch (audio_ctrl_state) {
-        // Volume control
-        case 0:
-          volume += (rot2_count-rot2_prev);
-          if (volume > 63) {
-            volume = 63;
-          }
-          else if (volume < 0) {
-            volume = 0;
-          }
-          audio_codec.setSpeakerVolume(volume);
-          //Serial.println((rot2_count - rot2_prev) + volume);
-          
-        
-        break;
-        // ACL control
-        case 1:
-          alc += rot2_count - rot2_prev;
-          if (alc > 15) {
-            alc = 15;
-            audio_codec.writeToRegister(NAU_DAC_CTRL_ADDR, NAU_DAC_CTRL_CMD);
-          }
-          else if (alc < 0) {
-            alc = 0;
-            audio_codec.writeToRegister(NAU_DAC_CTRL_ADDR, 0x0000);
-          }
-          audio_codec.setALCGain(alc);
-          break;
-
-        // Output control
-        case 2:
-          if (audio_output == 0) {
-            audio_output = 1;
-          }
-          else {
-            audio_output = 0;
-          }
-          audio_codec.setOutput(audio_output);
-          break;
-
-        // EQ1 control
-        case 3:
-          eq_gain[0] -= rot2_count - rot2_prev;
-          if (eq_gain[0] > 0x18) {
-            eq_gain[0] = 0x18;
-          }
-          else if (eq_gain[0] < 0) {
-            eq_gain[0] = 0;
-          }
-          audio_codec.setEQGain(1, eq_gain[0]);
-          break;
-
-        // EQ2 control
-        case 4:
-          eq_gain[1] -= rot2_count - rot2_prev;
-          if (eq_gain[1] > 0x18) {
-            eq_gain[1] = 0x18;
-          }
-          else if (eq_gain[1] < 0) {
-            eq_gain[1] = 0;
-          }
-          audio_codec.setEQGain(2, eq_gain[1]);
-          break;
-
-        // EQ3 control
-        case 5:
-          eq_gain[2] -= rot2_count - rot2_prev;
-          if (eq_gain[2] > 0x18) {
-            eq_gain[2] = 0x18;
-          }
-          else if (eq_gain[2] < 0) {
-            eq_gain[2] = 0;
-          }
-          audio_codec.setEQGain(3, eq_gain[2]);
-          break;
-
-        // EQ4 control
-        case 6:
-          eq_gain[3] -= rot2_count - rot2_prev;
-          if (eq_gain[3] > 0x18) {
-            eq_gain[3] = 0x18;
-          }
-          else if (eq_gain[3] < 0) {
-            eq_gain[3] = 0;
-          }
-          audio_codec.setEQGain(4, eq_gain[3]);
-          break;
-
-        // EQ5 control
-        case 7:
-          eq_gain[4] -= rot2_count - rot2_prev;
-          if (eq_gain[4] > 0x18) {
-            eq_gain[4] = 0x18;
-          }
-          else if (eq_gain[4] < 0) {
-            eq_gain[4] = 0;
-          }
-          audio_codec.setEQGain(5, eq_gain[4]);
-          break;
-      }
-      rot2_prev = 0;
-      rot2.clearCount();
-    }
+  if (codec_present) {
+    Serial.println(audio_codec.readRegisterFromDevice(NAU_ALC2_CTRL_ADDR), HEX);
+    Serial.println(audio_codec.readRegisterFromDevice(NAU_POWER2_ADDR), HEX);
+  }
 
+  if (!battery.begin()) {
+    Serial.println("Failed to start battery monitor");
+  }
 
+  if (power.begin(80, WAKE_PINS, sizeof(WAKE_PINS), WAKE_EDGE_MASK)) {
+    Serial.println("Power management unavailable, staying at 80 MHz");
+  }
 
-    // Read input voltage
-    digitalWrite(BAT_ADC_EN, HIGH);
-    delay(1);
-    batVoltage = 2.0 * 3.3 * (float)analogRead(BAT_ADC) / 4095.0;
-    digitalWrite(BAT_ADC_EN, LOW);
+  loop_task = xTaskGetCurrentTaskHandle();   // setup() and loop() share the Arduino loop task
 
+  attachInterrupt(ROT1_SW, ROT1_SW_ISR, CHANGE);
+  attachInterrupt(ROT2_SW, ROT2_SW_ISR, CHANGE);
+  attachInterrupt(BUT1, BUTTON_ISR, CHANGE);
 
-    display.setTextColor(SSD1306_WHITE);
+  const esp_timer_create_args_t display_timer_args = {
+    .callback = displayTick,
+    .arg = NULL,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "display",
+    .skip_unhandled_events = true   // A late tick isn't worth catching up on
+  };
+  if (esp_timer_create(&display_timer_args, &display_timer) == ESP_OK) {
+    esp_timer_start_periodic(display_timer, DISPLAY_TICK_PERIOD);
+  }
+  else {
+    Serial.println("Failed to create display timer");
+  }
 
+  rot1.attachSingleEdge(ROT1_A, ROT1_B);
+  rot2.attachSingleEdge(ROT2_A, ROT2_B);
 
-    // Print frequency to screen
-    display.clearDisplay();
-    display.setCursor(0, 0);
-    if (pll_freq + 10700000 < 100000000)
-    {
-      display.print(F(" "));
-      display.print((float)pll_freq / 1000000.0 + 10.7, 3);
-      display.print(F(" MHz"));
-    }
-    else
-    {
-      display.print((float)pll_freq / 1000000.0 + 10.7, 3);
-      display.print(F(" MHz"));
-    }
-    display.setCursor(0, 10);
-    display.print(F(" "));
-    // To consider decimal point
-    if (freq_digit > 1)
-    {
-      display.print(F(" "));
-    }
-    for (uint8_t i = 0; i < freq_digit; i++)
-    {
-      display.print(F(" "));
-    }
-    display.print(F("^"));
-    
-    // Print input voltage to LCD
-    display.setCursor(0, 16);
-    display.print("Bat: ");
-    display.print(batVoltage, 2);
-
-    // Print volume to LCD
-    display.setCursor(0,26);
-    if (audio_ctrl_state == 0) {
-      display.setTextColor(SSD1306_BLACK, SSD1306_WHITE);
-    }
-    display.print(F("Vol:"));
-    if (audio_ctrl_state == 0) {
-      display.setTextColor(SSD1306_WHITE, SSD1306_BLACK);
-    }
-    display.print(F(" "));
-    display.print(volume);
+  rot1.clearCount();
+  rot2.clearCount();
+  bootPhase("controls");
 
-    // Print ALC level to LCD
-    display.setCursor(0,36);
-    if (audio_ctrl_state == 1) {
-      display.setTextColor(SSD1306_BLACK, SSD1306_WHITE);
-    }
-    display.print(F("ALC:"));
-    if (audio_ctrl_state == 1) {
-      display.setTextColor(SSD1306_WHITE, SSD1306_BLACK);
-    }
-    display.print(F(" "));
-    display.print(alc);
+  // The panel has had the whole of the above to come up, this normally returns straight away
+  if (ui.waitReady(BOOT_DISPLAY_TIMEOUT) != UI_PANEL_OK) {
+    Serial.println("Failed to initialize OLED, running without display");
+  }
+  printBootTimes();
+}
 
+// Serial commands: 'i' dumps the I2C bus profile, 'r' resets it, 'b' runs the control benchmark,
+// 'a' prints audio pipeline load, 's' scans the band, 'u'/'d' seek up/down, 'l' lists stations,
+// 't' repeats the boot timings, 'm' toggles 48 kHz / 32 kHz low power audio, '1'-'8' recall a preset, 'p' followed by a slot number stores the current station there
+void handleSerialCommand(int command)
+{
+  if (command >= '1' && command < '1' + SETTINGS_NUM_PRESETS) {
+    recallPreset(command - '1');
+  }
+  switch (command) {
+    case 'b':
+      runBenchmark();
+      break;
+    case 'i':
+      i2c_profiler.dump(&Serial);
+      break;
+    case 'r':
+      i2c_profiler.reset();
+      break;
+    case 'a':
+      audio.dump(&Serial);
+      break;
+    case 's':
+      startScan();
+      break;
+    case 'u':
+      startSeek(1);
+      break;
+    case 'd':
+      startSeek(-1);
+      break;
+    case 'l':
+      scanner.dump(&Serial);
+      break;
+    case 't':
+      printBootTimes();
+      break;
+    case 'm':
+      toggleAudioClock();
+      break;
+    case 'p':
+      serial_arg_command = command;   // Slot number is the next character, whenever it arrives
+      serial_arg_time = millis();
+      break;
+  }
+}
 
-    // Print output selection to LCD
-    display.setCursor(0,46);
-    if (audio_ctrl_state == 2) {
-      display.setTextColor(SSD1306_BLACK, SSD1306_WHITE);
-    }
-    display.print(F("Out:"));
-    if (audio_ctrl_state == 2) {
-      display.setTextColor(SSD1306_WHITE, SSD1306_BLACK);
-    }
-    display.print(F(" "));
-    if (audio_output == 0) {
-      display.print(F("SPK"));
+// Second character of a two-character command, -1 if it never came
+void handleSerialArg(int command, int arg)
+{
+  if (command == 'p') {
+    int slot = arg - '1';
+    if (arg >= 0 && slot >= 0 && slot < SETTINGS_NUM_PRESETS) {
+      storePreset(slot);
     }
     else {
-      display.print(F("AUX"));
+      Serial.print("Preset slot must be 1-");
+      Serial.println(SETTINGS_NUM_PRESETS);
     }
+  }
+}
 
-    
-    // Print EQ levels to LCD
-    for (uint8_t i = 1; i <= 5; i++) {
-      display.setCursor(80,6+10*i);
-      if (audio_ctrl_state == i+2) {
-        display.setTextColor(SSD1306_BLACK, SSD1306_WHITE);
-      }
-      display.print(F("EQ"));
-      display.print(i);
-      display.print(F(":"));
-      if (audio_ctrl_state == i+2) {
-        display.setTextColor(SSD1306_WHITE, SSD1306_BLACK);
-      }
-      display.print(F(" "));
-      display.print(12-eq_gain[i-1]);
-    }
-
-
-    
-
-    // Print LO selection
-    display.setCursor(100,0);
-    if (LO_SELECT) {
-      display.print(F("PLL"));
+// Takes whatever has arrived without waiting for more, so a command whose
+// argument is still being typed doesn't hold up the controls
+void pollSerial()
+{
+  while (Serial.available()) {
+    int c = Serial.read();
+    if (serial_arg_command) {
+      int command = serial_arg_command;
+      serial_arg_command = 0;
+      handleSerialArg(command, c);
     }
     else {
-      display.print(F("EXT"));
+      handleSerialCommand(c);
     }
+  }
+  if (serial_arg_command && millis() - serial_arg_time >= SERIAL_ARG_TIMEOUT) {
+    int command = serial_arg_command;
+    serial_arg_command = 0;
+    handleSerialArg(command, -1);
+  }
+}
 
-    
+void loop()
+{
+  // Sleep until an ISR posts something. The 10 Hz display tick keeps this
+  // short in practice, the timeout only matters if the timer stops.
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOOP_IDLE_TIMEOUT));
 
-    display.display();
-    DISPLAY_FLAG = 0;
-  }
+  pollSerial();     // Ahead of the step, so a recalled preset is tuned this pass
+  controlStep();
 }
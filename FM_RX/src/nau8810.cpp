@@ -1,158 +1,760 @@
 #include <nau8810.h>
 
+// Power-on/software reset values from the NAU8810 datasheet register map
+static const uint16_t NAU_REG_DEFAULTS[NAU_NUM_REGS] = {
+    0x000, 0x000, 0x000, 0x000, 0x050, 0x000, 0x140, 0x000,     // 0x00 - 0x07
+    0x000, 0x000, 0x000, 0x0FF, 0x000, 0x000, 0x100, 0x0FF,     // 0x08 - 0x0F
+    0x000, 0x000, 0x12C, 0x02C, 0x02C, 0x02C, 0x02C, 0x000,     // 0x10 - 0x17
+    0x032, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000,     // 0x18 - 0x1F
+    0x038, 0x00B, 0x032, 0x000, 0x008, 0x00C, 0x093, 0x0E9,     // 0x20 - 0x27
+    0x000, 0x000, 0x000, 0x000, 0x003, 0x010, 0x000, 0x100,     // 0x28 - 0x2F
+    0x000, 0x002, 0x001, 0x000, 0x000, 0x000, 0x039, 0x000,     // 0x30 - 0x37
+    0x001, 0x000, 0x000, 0x000, 0x020, 0x000, 0x000, 0x01A,     // 0x38 - 0x3F
+    0x0CA, 0x124, 0x000, 0x000, 0x000, 0x001, 0x010, 0x000,     // 0x40 - 0x47
+    0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000      // 0x48 - 0x4F
+};
+
+// INIT PROFILES
+
+static constexpr NAU8810RegWrite NAU_DEFAULT_WRITES[] = {
+    { NAU_RESET_ADDR,           NAU_RESET_CMD },
+    { NAU_POWER1_ADDR,          NAU_POWER1_CMD },
+    { NAU_POWER2_ADDR,          NAU_POWER2_CMD },
+    { NAU_POWER3_ADDR,          NAU_POWER3_CMD },
+    { NAU_ADC_LOOPBACK_ADDR,    NAU_ADC_LOOPBACK_CMD },
+    { NAU_CLK_CTRL_ADDR,        NAU_CLK_CTRL_CMD },
+    { NAU_ALC1_CTRL_ADDR,       NAU_ALC1_CTRL_CMD },
+    { NAU_OUT_CTRL_ADDR,        NAU_OUT_CTRL_CMD },
+    { NAU_DAC_CTRL_ADDR,        NAU_DAC_CTRL_CMD }
+};
+
+static constexpr NAU8810RegWrite NAU_PGA_INPUT_WRITES[] = {
+    { NAU_INPUT_CTRL_ADDR,      NAU_INPUT_CTRL_CMD },
+    { NAU_PGA_GAIN_ADDR,        NAU_PGA_GAIN_CMD },
+    { NAU_ADC_CTRL_ADDR,        NAU_ADC_CTRL_CMD }
+};
+
+static constexpr NAU8810RegWrite NAU_ANALOG_BYPASS_WRITES[] = {
+    { NAU_SPEAKER_MIXER_ADDR,   NAU_SPEAKER_MIXER_CMD },
+    { NAU_SPEAKER_GAIN_ADDR,    NAU_SPEAKER_GAIN_CMD }
+};
+
+static constexpr NAU8810RegWrite NAU_EQ_ADC_PATH_WRITES[] = {
+    { NAU_EQ_CTRL1_ADDR,        NAU_EQ_CTRL1_CMD }
+};
+
+#define NAU_PROFILE(writes) { writes, sizeof(writes) / sizeof(writes[0]) }
+
+const NAU8810Profile NAU_PROFILE_DEFAULT = NAU_PROFILE(NAU_DEFAULT_WRITES);
+const NAU8810Profile NAU_PROFILE_PGA_INPUT = NAU_PROFILE(NAU_PGA_INPUT_WRITES);
+const NAU8810Profile NAU_PROFILE_ANALOG_BYPASS = NAU_PROFILE(NAU_ANALOG_BYPASS_WRITES);
+const NAU8810Profile NAU_PROFILE_EQ_ADC_PATH = NAU_PROFILE(NAU_EQ_ADC_PATH_WRITES);
+
+
 NAU8810::NAU8810(int ADDR, TwoWire *i2c_wire)
 {
     _addr = ADDR;
     _wire = i2c_wire;
+    _initProfile = NULL;
+    _staging = false;
+    _txnDepth = 0;
+    _txnFlags = 0;
+    _txnOwnsStaging = false;
+    resetShadow();
+}
+
+void NAU8810::resetShadow()
+{
+    memcpy(_regs, NAU_REG_DEFAULTS, sizeof(_regs));
+    memset(_staged, 0, sizeof(_staged));
 }
 
 uint8_t NAU8810::writeToRegister(uint8_t reg, uint16_t value)
+{
+    value &= 0x01FF; // Registers are 9 bits wide
+
+    if (reg != NAU_RESET_ADDR && reg < NAU_NUM_REGS)
+    {
+        // Skip the bus entirely if the chip already holds this value (reset always goes out)
+        if (_regs[reg] == value && !isStaged(reg))
+        {
+            return 0;
+        }
+        if (_staging)
+        {
+            _regs[reg] = value;
+            _staged[reg >> 3] |= 1 << (reg & 7);
+            return 0;
+        }
+    }
+
+    uint8_t err = busWrite(reg, value);
+    if (!err)
+    {
+        if (reg == NAU_RESET_ADDR)
+        {
+            resetShadow();
+        }
+        else if (reg < NAU_NUM_REGS)
+        {
+            _regs[reg] = value;
+            _staged[reg >> 3] &= ~(1 << (reg & 7));
+        }
+    }
+    return err;
+}
+
+uint8_t NAU8810::busWrite(uint8_t reg, uint16_t value)
 {
     uint8_t data[2];
     data[0] = (reg << 1) | ((value >> 8) & 0x0001); // First seven bits are register address, last bit is MSB of 9-bit value data
     data[1] = value & 0x00FF;                       // Last 8 bits of 9-bit value data
+    uint32_t start = micros();
     _wire->beginTransmission(_addr);
     _wire->write(data[0]);
     _wire->write(data[1]);
-    return _wire->endTransmission(); // Zero means success
+    uint8_t err = _wire->endTransmission(); // Zero means success
+    i2c_profiler.transaction(_addr, 2, err, micros() - start);
+    return err;
+}
+
+void NAU8810::beginStaging()
+{
+    _staging = true;
+}
+
+// For registers with strobe bits: queues the write even when the shadow
+// already holds the value. Only valid while staging.
+void NAU8810::forceStage(uint8_t reg, uint16_t value)
+{
+    _regs[reg] = value & 0x01FF;
+    _staged[reg >> 3] |= 1 << (reg & 7);
+}
+
+// Stops at the first register the codec doesn't ACK, failedReg gets its
+// address or NAU_PROFILE_OK
+uint8_t NAU8810::commitStaged(uint8_t *failedReg)
+{
+    uint8_t err = 0;
+    _staging = false;
+    if (failedReg)
+    {
+        *failedReg = NAU_PROFILE_OK;
+    }
+
+    for (uint8_t reg = 0; reg < NAU_NUM_REGS && !err; reg++)
+    {
+        if (!isStaged(reg))
+        {
+            continue;
+        }
+        err = busWrite(reg, _regs[reg]);
+        if (!err)
+        {
+            _staged[reg >> 3] &= ~(1 << (reg & 7));
+        }
+        else if (failedReg)
+        {
+            *failedReg = reg;
+        }
+    }
+    return err;
+}
+
+// Read-modify-write of the bits in mask, merged against the shadow copy
+uint8_t NAU8810::updateRegister(uint8_t reg, uint16_t mask, uint16_t value)
+{
+    return writeToRegister(reg, (readRegister(reg) & ~mask) | (value & mask));
 }
 
 uint16_t NAU8810::readRegister(uint8_t reg)
+{
+    if (reg < NAU_NUM_REGS)
+    {
+        return _regs[reg];
+    }
+    return readRegisterFromDevice(reg);
+}
+
+uint16_t NAU8810::readRegisterFromDevice(uint8_t reg)
 {
     uint16_t data;
 
+    uint32_t start = micros();
     _wire->beginTransmission(_addr);
     _wire->write(reg << 1);
-    _wire->endTransmission();
+    uint8_t err = _wire->endTransmission();
+    i2c_profiler.transaction(_addr, 1, err, micros() - start);
 
-    _wire->requestFrom(_addr, 2);
+    start = micros();
+    uint8_t count = _wire->requestFrom(_addr, 2);
+    i2c_profiler.transaction(_addr, 2, count != 2, micros() - start);
     data = _wire->read();  // Read first byte
     data = data << 8;      // Shift over 8 bits
     data |= _wire->read(); // Read second byte
     return data;
 }
 
+void NAU8810::beginTransaction(uint8_t flags)
+{
+    if (_txnDepth++ == 0)
+    {
+        _txnOwnsStaging = !_staging;
+        _txnFlags = 0;
+        beginStaging();
+    }
+    _txnFlags |= flags;
+}
+
+// Gain registers and their zero-cross bit: PGA, ALC, speaker
+static const NAU8810RegWrite NAU_ZERO_CROSS_BITS[] = {
+    { NAU_PGA_GAIN_ADDR, NAU_PGA_ZC },
+    { NAU_ALC2_CTRL_ADDR, NAU_ALC_ZC },
+    { NAU_SPEAKER_GAIN_ADDR, NAU_SPEAKER_ZC }
+};
+
+// The chip has no auto-increment, so "one burst" is the staged registers
+// going out back-to-back in address order with nothing else in between.
+// A muted commit ramps the DAC down first and brings it back afterwards,
+// unless the batch itself leaves the DAC muted.
+uint8_t NAU8810::commitTransaction(uint8_t *failedReg)
+{
+    if (failedReg)
+    {
+        *failedReg = NAU_PROFILE_OK;
+    }
+    if (!_txnDepth || --_txnDepth || !_txnOwnsStaging)
+    {
+        return 0;   // Nested, or the enclosing staging commits it
+    }
+
+    bool pending = false;
+    for (uint8_t i = 0; i < sizeof(_staged); i++)
+    {
+        pending |= _staged[i] != 0;
+    }
+    if (!pending)
+    {
+        _staging = false;
+        return 0;
+    }
+
+    if (_txnFlags & NAU_TXN_ZERO_CROSS)
+    {
+        for (uint8_t i = 0; i < sizeof(NAU_ZERO_CROSS_BITS) / sizeof(NAU_ZERO_CROSS_BITS[0]); i++)
+        {
+            if (isStaged(NAU_ZERO_CROSS_BITS[i].reg))
+            {
+                _regs[NAU_ZERO_CROSS_BITS[i].reg] |= NAU_ZERO_CROSS_BITS[i].value;
+            }
+        }
+    }
+
+    // A staged DAC control change (de-emphasis, say) rides along with the
+    // mute write and is what the unmute restores
+    uint16_t dac = _regs[NAU_DAC_CTRL_ADDR];
+    bool mute = (_txnFlags & NAU_TXN_SOFT_MUTE) && !(dac & NAU_DAC_SOFTMUTE);
+    if (mute && !busWrite(NAU_DAC_CTRL_ADDR, dac | NAU_DAC_SOFTMUTE))
+    {
+        _staged[NAU_DAC_CTRL_ADDR >> 3] &= ~(1 << (NAU_DAC_CTRL_ADDR & 7));
+        delay(NAU_SOFTMUTE_MS);
+    }
+    else
+    {
+        mute = false;
+    }
+
+    uint8_t err = commitStaged(failedReg);
+    if (mute)
+    {
+        uint8_t unmuteErr = busWrite(NAU_DAC_CTRL_ADDR, dac);
+        if (unmuteErr)
+        {   // Chip is still muted, keep the register staged so the next write or commit retries it
+            _staged[NAU_DAC_CTRL_ADDR >> 3] |= 1 << (NAU_DAC_CTRL_ADDR & 7);
+            if (!err)
+            {
+                err = unmuteErr;
+                if (failedReg)
+                {
+                    *failedReg = NAU_DAC_CTRL_ADDR;
+                }
+            }
+        }
+    }
+    return err;
+}
+
+// Only the gain field changes, the band's frequency, bandwidth and the EQ1
+// path bit stay as setEQBand()/setEQPath() or the init profile left them
 uint8_t NAU8810::setEQGain(uint8_t band, uint8_t volume) {
+    I2CProfileScope profile(I2C_SITE_SET_EQ_GAIN);
+    if (band < 1 || band > NAU_EQ_BANDS) {
+        return NAU_BAD_PARAM;
+    }
     if (volume > 0x1F) {
         volume = 0x1F;
     }
+    return updateRegister(NAU_EQ_CTRL1_ADDR + band - 1, NAU_EQ_GAIN, volume);
+}
 
-    if (band == 1) {
-        return writeToRegister(0x12+band-1, 0x0120 | volume);
+// Cut-off (bands 1 and 5, shelving) or centre frequency of each EQ band, Hz
+static const uint16_t NAU_EQ_FREQS[NAU_EQ_BANDS][4] = {
+    {   80,  105,  135,  175 },
+    {  230,  300,  385,  500 },
+    {  650,  850, 1100, 1400 },
+    { 1800, 2400, 3200, 4100 },
+    { 5300, 6900, 9000, 11700 }
+};
+
+uint16_t NAU8810::eqFrequency(uint8_t band, uint8_t freq)
+{
+    if (band < 1 || band > NAU_EQ_BANDS || freq > 3)
+    {
+        return 0;
     }
-    else {
-        return writeToRegister(0x12+band-1, 0x0020 | volume);
+    return NAU_EQ_FREQS[band - 1][freq];
+}
+
+// freq picks one of the four eqFrequency() points. Only the peaking bands
+// 2 - 4 have a bandwidth bit, wide is ignored for the shelves.
+uint8_t NAU8810::setEQBand(uint8_t band, uint8_t freq, bool wide)
+{
+    I2CProfileScope profile(I2C_SITE_SET_DSP);
+    if (band < 1 || band > NAU_EQ_BANDS || freq > 3)
+    {
+        return NAU_BAD_PARAM;
+    }
+    uint8_t reg = NAU_EQ_CTRL1_ADDR + band - 1;
+    if (band == 1 || band == NAU_EQ_BANDS)
+    {
+        return updateRegister(reg, NAU_EQ_FREQ, freq << 5);
+    }
+    return updateRegister(reg, NAU_EQ_WIDE | NAU_EQ_FREQ, (wide ? NAU_EQ_WIDE : 0) | (freq << 5));
+}
+
+uint8_t NAU8810::setEQPath(bool dac)
+{
+    I2CProfileScope profile(I2C_SITE_SET_DSP);
+    return updateRegister(NAU_EQ_CTRL1_ADDR, NAU_EQ_DAC_PATH, dac ? NAU_EQ_DAC_PATH : 0);
+}
+
+// The ADC notch is H(z) = (1 + a0)/2 * (1 + 2 a1/(1 + a0) z^-1 + z^-2) / (1 + a1 z^-1 + a0 z^-2)
+// with a0 = (1 - tan(wb/2)) / (1 + tan(wb/2)) and a1 = -(1 + a0) cos(w0).
+// The chip takes -a0 * 2^13 and -a1 * 2^12 as 14-bit two's complement.
+uint8_t NAU8810::setNotch(uint32_t sampleRate, uint32_t centreHz, uint32_t bandwidthHz)
+{
+    if (!sampleRate || !bandwidthHz || centreHz * 2 >= sampleRate || bandwidthHz * 2 >= sampleRate)
+    {
+        return NAU_BAD_PARAM;
     }
+    double t = tan(M_PI * bandwidthHz / sampleRate);
+    double a0 = (1.0 - t) / (1.0 + t);
+    double a1 = -(1.0 + a0) * cos(2.0 * M_PI * centreHz / sampleRate);
+    long c0 = lround(-a0 * 8192.0);
+    long c1 = lround(-a1 * 4096.0);
+    return setNotchCoefficients(constrain(c0, -8192L, 8191L), constrain(c1, -8192L, 8191L), true);
+}
+
+// Raw coefficients as the datasheet tables give them. The four registers go
+// out back-to-back and only the last one sets the update bit, so the filter
+// switches to the new pair in one step.
+uint8_t NAU8810::setNotchCoefficients(int16_t a0, int16_t a1, bool enable)
+{
+    I2CProfileScope profile(I2C_SITE_SET_DSP);
+    if (a0 < -8192 || a0 > 8191 || a1 < -8192 || a1 > 8191)
+    {
+        return NAU_BAD_PARAM;
+    }
+    uint16_t c0 = a0 & 0x3FFF;
+    uint16_t c1 = a1 & 0x3FFF;
+    uint16_t values[4] = {
+        (uint16_t)((enable ? NAU_NOTCH_EN : 0) | (c0 >> 7)),
+        (uint16_t)(c0 & 0x7F),
+        (uint16_t)(c1 >> 7),
+        (uint16_t)(NAU_NOTCH_UPDATE | (c1 & 0x7F))
+    };
+
+    // Already latched, nothing to send
+    bool changed = false;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        changed |= _regs[NAU_NOTCH1_ADDR + i] != values[i] || isStaged(NAU_NOTCH1_ADDR + i);
+    }
+    if (!changed)
+    {
+        return 0;
+    }
+
+    uint8_t err = 0;
+    bool staging = _staging;
+    beginStaging();
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        writeToRegister(NAU_NOTCH1_ADDR + i, values[i]);
+    }
+    forceStage(NAU_NOTCH1_ADDR + 3, values[3]);     // The update strobe has to go out even if the value didn't change
+    if (!staging)
+    {
+        err = commitStaged();
+    }
+    return err;
+}
+
+// Goes through the same latched write as the coefficients, NFCEN only takes
+// effect with the update bit, and the shadow keeps the last coefficients
+uint8_t NAU8810::disableNotch()
+{
+    int16_t a0 = (int16_t)(((_regs[NAU_NOTCH1_ADDR] & 0x7F) << 7 | (_regs[NAU_NOTCH1_ADDR + 1] & 0x7F)) << 2) >> 2;
+    int16_t a1 = (int16_t)(((_regs[NAU_NOTCH1_ADDR + 2] & 0x7F) << 7 | (_regs[NAU_NOTCH1_ADDR + 3] & 0x7F)) << 2) >> 2;
+    return setNotchCoefficients(a0, a1, false);
+}
+
+// threshold 0 - 5 is -1 to -6 dB, boost 0 - 12 adds that many dB in front of the limiter
+uint8_t NAU8810::setDACLimiter(bool enable, uint8_t threshold, uint8_t boost)
+{
+    I2CProfileScope profile(I2C_SITE_SET_DSP);
+    if (threshold > 5 || boost > 12)
+    {
+        return NAU_BAD_PARAM;
+    }
+    uint8_t err = updateRegister(NAU_DAC_LIM2_ADDR, 0x07F, (threshold << 4) | boost);
+    if (err)
+    {
+        return err;
+    }
+    return updateRegister(NAU_DAC_LIM1_ADDR, NAU_DAC_LIM_EN, enable ? NAU_DAC_LIM_EN : 0);
+}
+
+uint8_t NAU8810::setDACLimiterTiming(uint8_t attack, uint8_t decay)
+{
+    I2CProfileScope profile(I2C_SITE_SET_DSP);
+    if (attack > 10 || decay > 10)
+    {
+        return NAU_BAD_PARAM;
+    }
+    return updateRegister(NAU_DAC_LIM1_ADDR, 0x0FF, (decay << 4) | attack);
+}
+
+// minGain 0 - 7 is -12 to +30 dB, maxGain 0 - 7 is -6.75 to +35.25 dB, both in 6 dB steps
+uint8_t NAU8810::setALC(bool enable, uint8_t minGain, uint8_t maxGain)
+{
+    I2CProfileScope profile(I2C_SITE_SET_DSP);
+    if (minGain > 7 || maxGain > 7)
+    {
+        return NAU_BAD_PARAM;
+    }
+    return updateRegister(NAU_ALC1_CTRL_ADDR, NAU_ALC_EN | 0x03F,
+                          (enable ? NAU_ALC_EN : 0) | (maxGain << 3) | minGain);
+}
+
+// Codes 0 - 10, each step doubles the time. Hold starts at 0 ms, attack at
+// 125 us (normal) / 31 us (limiter), decay at 500 us (normal) / 125 us (limiter).
+uint8_t NAU8810::setALCTiming(uint8_t hold, uint8_t attack, uint8_t decay, bool limiterMode)
+{
+    I2CProfileScope profile(I2C_SITE_SET_DSP);
+    if (hold > 10 || attack > 10 || decay > 10)
+    {
+        return NAU_BAD_PARAM;
+    }
+    uint8_t err = updateRegister(NAU_ALC2_CTRL_ADDR, 0x0F0, hold << 4);
+    if (err)
+    {
+        return err;
+    }
+    return writeToRegister(NAU_ALC3_ADDR, (limiterMode ? NAU_ALC_LIMITER : 0) | (decay << 4) | attack);
+}
+
+// threshold 0 - 7 is -39 to -81 dB in 6 dB steps. Below it the ALC holds its
+// gain instead of pumping the noise floor up between stations.
+uint8_t NAU8810::setNoiseGate(bool enable, uint8_t threshold)
+{
+    I2CProfileScope profile(I2C_SITE_SET_DSP);
+    if (threshold > 7)
+    {
+        return NAU_BAD_PARAM;
+    }
+    return writeToRegister(NAU_NOISE_GATE_ADDR, (enable ? NAU_NOISE_GATE_EN : 0) | threshold);
 }
 
 uint8_t NAU8810::setSpeakerVolume(uint8_t volume)
 {
+    I2CProfileScope profile(I2C_SITE_SET_SPEAKER_VOLUME);
     // Speaker volume can range from 0 to 63 (-53 to +6 dB of speaker gain in 1 dB increments)
     if (volume > 63)
     { // Check max value
         volume = 63;
     }
 
-    uint8_t settings = readRegister(NAU_SPEAKER_GAIN_ADDR) & 0x0C0;
-    return writeToRegister(NAU_SPEAKER_GAIN_ADDR, settings | volume);
+    return updateRegister(NAU_SPEAKER_GAIN_ADDR, 0x03F, volume);   // Keep zero-cross and mute bits
 }
 
 uint8_t NAU8810::setALCGain(uint8_t volume)
 {
-    return writeToRegister(NAU_ALC2_CTRL_ADDR, volume);
+    I2CProfileScope profile(I2C_SITE_SET_ALC_GAIN);
+    return updateRegister(NAU_ALC2_CTRL_ADDR, 0x00F, volume);    // Target level, keep hold time and zero-cross
 }
 
+// Both outputs switch inside one muted transaction, so neither the
+// half-way state (both on or both off) nor the step itself is heard. The
+// mute ramp blocks for NAU_SOFTMUTE_MS, so it's only paid when the route
+// actually changes.
 uint8_t NAU8810::setOutput(uint8_t output) {
+    I2CProfileScope profile(I2C_SITE_SET_OUTPUT);
+    bool speaker = !(readRegister(NAU_SPEAKER_GAIN_ADDR) & 0x040);
+    bool mono = !(readRegister(NAU_OUT_CTRL_ADDR) & 0x010);
+    if (speaker == (output == 0) && mono == (output != 0)) {
+        return 0;
+    }
+    beginTransaction(NAU_TXN_SOFT_MUTE);
     // If output = 0, output on speaker, if output = 1, output on mono
-    uint8_t volume = readRegister(NAU_SPEAKER_GAIN_ADDR) & 0x03F;
     if (output == 0) {
-        writeToRegister(NAU_SPEAKER_GAIN_ADDR, volume);     // Write volume and unmute speaker
-        return writeToRegister(NAU_OUT_CTRL_ADDR, 0x010);   // Mute mono
+        updateRegister(NAU_SPEAKER_GAIN_ADDR, 0x040, 0x000);    // Keep volume and zero-cross, unmute speaker
+        writeToRegister(NAU_OUT_CTRL_ADDR, 0x010);              // Mute mono
     }
     else {
-        writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x040 | volume); // Write volume and mute speaker
-        return writeToRegister(NAU_OUT_CTRL_ADDR, 0x000);       // Unmute mono
+        updateRegister(NAU_SPEAKER_GAIN_ADDR, 0x040, 0x040);    // Keep volume and zero-cross, mute speaker
+        writeToRegister(NAU_OUT_CTRL_ADDR, 0x000);              // Unmute mono
     }
+    return commitTransaction();
 }
 
-uint8_t NAU8810::setPLL(uint32_t inputFreq)
+// MCLKSEL dividers times two, indexed by the register field
+static const uint8_t NAU_MCLKSEL_DIV_X2[8] = { 2, 3, 4, 6, 8, 12, 16, 24 };
+
+// Tries every prescaler and MCLKSEL divider whose f2 lands in the PLL's
+// range and keeps the one closest to the requested IMCLK. All integer: K
+// needs the full 24 bits, which a float can't hold next to the integer part.
+uint8_t NAU8810::solvePLL(uint32_t mclk, uint32_t imclk, NAU8810PLLConfig *config)
 {
-    uint8_t err;
-    // inputFreq is the frequency sent to the MCLK pin on the codec
-    // Assume desired 12.288 MHz at this point
-    float R = 12288000.0 * 4.0 / (float)inputFreq; // *4 to compensate for divide by 4? *2 for M/2?
-    if (R < 5.0 || R > 13.0)
+    bool found = false;
+    int64_t bestError = 0;
+
+    if (!mclk || !config)
     {
-        return 1; // Error, integer divider can't be less than 5
+        return NAU_PLL_NO_SOLUTION;
     }
-    uint8_t integer = (uint8_t)R; // Integer part of divider
 
-    float K = (R - (float)integer) * 16777216; // Take the decimal portion * 2^24
-    uint32_t fractional = (uint32_t)K;
-
-    err = writeToRegister(NAU_PLL1_ADDR, integer);
-    if (!err)
+    for (uint8_t prescale = 1; prescale <= 2; prescale++)
     {
-        err = writeToRegister(NAU_PLL2_ADDR, fractional >> 18);
-        if (!err)
+        for (uint8_t sel = 0; sel < 8; sel++)
         {
-            err = writeToRegister(NAU_PLL3_ADDR, (fractional & 0x0003FE00) >> 9);
-            if (!err)
+            uint64_t f2 = 2ULL * imclk * NAU_MCLKSEL_DIV_X2[sel];   // 4 * IMCLK * divider
+            if (f2 < NAU_PLL_F2_MIN || f2 > NAU_PLL_F2_MAX)
+            {
+                continue;
+            }
+
+            // R = f2 / (MCLK / prescale), as N + K / 2^24 with K rounded
+            uint64_t num = f2 * prescale;
+            uint64_t n = num / mclk;
+            uint64_t k = ((num % mclk << NAU_PLL_K_BITS) + mclk / 2) / mclk;
+            if (k >> NAU_PLL_K_BITS)
+            {
+                n++;
+                k = 0;
+            }
+            if (n < NAU_PLL_N_MIN || n > NAU_PLL_N_MAX)
+            {
+                continue;
+            }
+
+            // (achieved - target) / target, both sides scaled by prescale * 2^24
+            uint64_t achieved = ((n << NAU_PLL_K_BITS) | k) * mclk;
+            uint64_t target = num << NAU_PLL_K_BITS;
+            int64_t diff = ((int64_t)achieved - (int64_t)target) * 1000000000LL;
+            int64_t error = (diff + (diff < 0 ? -1 : 1) * (int64_t)(target / 2)) / (int64_t)target;
+            if (!found || llabs(error) < llabs(bestError))
             {
-                err = writeToRegister(NAU_PLL4_ADDR, fractional & 0x000001FF);
+                found = true;
+                bestError = error;
+                config->prescale = prescale;
+                config->mclkSel = sel;
+                config->n = n;
+                config->k = k;
+                config->f2 = f2;
+                uint64_t den = (uint64_t)prescale * NAU_MCLKSEL_DIV_X2[sel] << (NAU_PLL_K_BITS + 1);
+                config->imclk = (achieved + den / 2) / den;
+                config->errorPpb = error;
             }
         }
     }
-    return R;
+    return found ? 0 : NAU_PLL_NO_SOLUTION;
 }
 
-uint8_t NAU8810::begin()
+// mclk is the frequency on the codec's MCLK pin, imclk the internal master
+// clock wanted (256 fs). Only the PLL registers are written, selecting the
+// PLL and MCLKSEL in the clock control register is up to the caller, which
+// gets the settings back through config. Returns 0, NAU_PLL_NO_SOLUTION or
+// the Wire error of the batch.
+uint8_t NAU8810::setPLL(uint32_t mclk, uint32_t imclk, NAU8810PLLConfig *config)
 {
+    I2CProfileScope profile(I2C_SITE_SET_PLL);
+    NAU8810PLLConfig pll;
+    uint8_t err = solvePLL(mclk, imclk, &pll);
+    if (err)
+    {
+        return err;
+    }
+    if (config)
+    {
+        *config = pll;
+    }
 
-    _wire->begin();
-    uint8_t err;
-    // Could split these settings into different commands if wanted, I used these defaults for my case
-    err = writeToRegister(NAU_RESET_ADDR, NAU_RESET_CMD);
-    if (!err)
+    // All four go out back-to-back so the PLL never runs on a half-written
+    // ratio. A caller that is already staging commits them itself.
+    bool staging = _staging;
+    beginStaging();
+    writeToRegister(NAU_PLL1_ADDR, (pll.prescale == 2 ? NAU_PLL_PRESCALE : 0) | pll.n);
+    writeToRegister(NAU_PLL2_ADDR, pll.k >> 18);
+    writeToRegister(NAU_PLL3_ADDR, (pll.k >> 9) & 0x01FF);
+    writeToRegister(NAU_PLL4_ADDR, pll.k & 0x01FF);
+    if (!staging)
     {
-        err = writeToRegister(NAU_POWER1_ADDR, NAU_POWER1_CMD);
-        if (!err)
+        err = commitStaged();
+    }
+    return err;
+}
+
+// SMPLR field value for a sample rate, 0xFF if the filters have no setting for it
+static uint8_t sampleRateField(uint32_t sampleRate)
+{
+    switch (sampleRate)
+    {
+        case 48000:
+        case 44100:
+            return 0;
+        case 32000:
+            return 1;
+        case 24000:
+        case 22050:
+            return 2;
+        case 16000:
+            return 3;
+        case 12000:
+        case 11025:
+            return 4;
+        case 8000:
+            return 5;
+    }
+    return 0xFF;
+}
+
+// Sets up IMCLK (256 fs), the filter sample rate and the interface word
+// length for a new I2S format. MCLK is divided down directly when it is an
+// exact MCLKSEL multiple of IMCLK, otherwise the PLL makes IMCLK; pll gets
+// the PLL settings, with n = 0 when the PLL is bypassed. A de-emphasis
+// filter that is switched on follows the sample rate. Returns 0,
+// NAU_CLK_BAD_FORMAT, NAU_PLL_NO_SOLUTION or a Wire error.
+uint8_t NAU8810::setClocking(uint32_t mclk, uint32_t sampleRate, uint8_t wordLength, NAU8810PLLConfig *pll)
+{
+    I2CProfileScope profile(I2C_SITE_SET_CLOCKING);
+    uint8_t smplr = sampleRateField(sampleRate);
+    uint8_t wlen;
+    switch (wordLength)
+    {
+        case 16: wlen = 0; break;
+        case 20: wlen = 1; break;
+        case 24: wlen = 2; break;
+        case 32: wlen = 3; break;
+        default: wlen = 0xFF; break;
+    }
+    if (smplr == 0xFF || wlen == 0xFF)
+    {
+        return NAU_CLK_BAD_FORMAT;
+    }
+
+    uint32_t imclk = sampleRate * 256;
+    NAU8810PLLConfig config;
+    memset(&config, 0, sizeof(config));
+    uint16_t clk = 0xFF;
+    for (uint8_t sel = 0; sel < 8; sel++)
+    {
+        if ((uint64_t)imclk * NAU_MCLKSEL_DIV_X2[sel] == 2ULL * mclk)
         {
-            err = writeToRegister(NAU_POWER2_ADDR, NAU_POWER2_CMD);
-            if (!err)
-            {
-                err = writeToRegister(NAU_POWER3_ADDR, NAU_POWER3_CMD);
-                if (!err)
-                {
-                    err = writeToRegister(NAU_ADC_LOOPBACK_ADDR, NAU_ADC_LOOPBACK_CMD);
-                    if (!err)
-                    {
-                        err = writeToRegister(NAU_CLK_CTRL_ADDR, NAU_CLK_CTRL_CMD);
-                        if (!err)
-                        {
-                            err = writeToRegister(NAU_ALC1_CTRL_ADDR, NAU_ALC1_CTRL_CMD);
-                            if (!err)
-                            {
-                                err = writeToRegister(NAU_OUT_CTRL_ADDR, NAU_OUT_CTRL_CMD);
-                                if (!err)
-                                {
-                                    err = writeToRegister(NAU_DAC_CTRL_ADDR, NAU_DAC_CTRL_CMD);
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+            clk = sel << 5;
+            config.mclkSel = sel;
+            config.imclk = imclk;
+            break;
         }
     }
 
+    uint8_t err = 0;
+    if (clk == 0xFF)
+    {   // The PLL ratio goes out first so CLKM never selects a half-programmed PLL
+        err = setPLL(mclk, imclk, &config);
+        if (err)
+        {
+            return err;
+        }
+        clk = NAU_CLK_CTRL_CLKM | (config.mclkSel << 5);
+    }
+    if (pll)
+    {
+        *pll = config;
+    }
+
+    bool staging = _staging;
+    beginStaging();
+    updateRegister(NAU_CLK_CTRL_ADDR, NAU_CLK_CTRL_CLKM | NAU_CLK_CTRL_MCLKSEL, clk);
+    updateRegister(NAU_CLK_CTRL2_ADDR, NAU_CLK_CTRL2_SMPLR, smplr << 1);
+    updateRegister(NAU_AUDIO_IF_ADDR, NAU_AUDIO_IF_WLEN, wlen << 5);
+    if (readRegister(NAU_DAC_CTRL_ADDR) & NAU_DAC_DEEMP)
+    {
+        uint16_t deemp = sampleRate == 32000 ? 0x0010 : sampleRate == 44100 ? 0x0020 : sampleRate == 48000 ? 0x0030 : 0;
+        if (deemp)
+        {
+            updateRegister(NAU_DAC_CTRL_ADDR, NAU_DAC_DEEMP, deemp);
+        }
+    }
+    if (!staging)
+    {
+        err = commitStaged();
+    }
+    return err;
+}
+
+// The optional profiles only touch their own registers, so they go on top of
+// the default one rather than replacing it. NULL (or NAU_PROFILE_DEFAULT)
+// leaves begin() with the default alone.
+void NAU8810::setInitProfile(const NAU8810Profile *profile)
+{
+    _initProfile = profile == &NAU_PROFILE_DEFAULT ? NULL : profile;
+}
+
+// Writes every entry in order and stops at the first one the codec doesn't ACK.
+// failedEntry gets the index of that entry, or NAU_PROFILE_OK.
+uint8_t NAU8810::applyProfile(const NAU8810Profile *profile, uint8_t *failedEntry)
+{
+    uint8_t err = 0;
+    uint8_t i;
+    for (i = 0; i < profile->length && !err; i++)
+    {
+        err = writeToRegister(profile->writes[i].reg, profile->writes[i].value);
+    }
+    if (failedEntry)
+    {
+        *failedEntry = err ? i - 1 : NAU_PROFILE_OK;
+    }
     return err; // Zero means success
+}
 
-    // UNUSED COMMANDS:
-    // err = writeToRegister(NAU_INPUT_CTRL_ADDR, NAU_INPUT_CTRL_CMD);
-    // err = writeToRegister(NAU_SPEAKER_GAIN_ADDR, NAU_SPEAKER_GAIN_CMD);
-    // err = writeToRegister(NAU_ADC_CTRL_ADDR, NAU_ADC_CTRL_CMD);
-    // err = writeToRegister(NAU_PGA_GAIN_ADDR, NAU_PGA_GAIN_CMD);
-    // err = writeToRegister(NAU_EQ_CTRL1_ADDR, NAU_EQ_CTRL1_CMD);
-    // err = writeToRegister(NAU_SPEAKER_MIXER_ADDR, NAU_SPEAKER_MIXER_CMD);
-}
\ No newline at end of file
+// Reset and power-up always come from NAU_PROFILE_DEFAULT, then the profile
+// from setInitProfile() is layered on top. failedEntry counts through both as
+// one list, so an index past the default profile's length is in the extra one.
+uint8_t NAU8810::begin(uint8_t *failedEntry)
+{
+    I2CProfileScope profile(I2C_SITE_CODEC_INIT);
+    _wire->begin();
+    resetShadow(); // Chip state is unknown until the reset in the profile lands, start from datasheet defaults
+    uint8_t err = applyProfile(&NAU_PROFILE_DEFAULT, failedEntry);
+    if (err || !_initProfile)
+    {
+        return err;
+    }
+    err = applyProfile(_initProfile, failedEntry);
+    if (err && failedEntry)
+    {
+        *failedEntry += NAU_PROFILE_DEFAULT.length;
+    }
+    return err;
+}
@@ -2,6 +2,7 @@
 #define NAU8810_h
 
 #include <Wire.h>
+#include <i2c_profiler.h>
 
 #define NAU_RESET_ADDR 0x00  // Software reset address
 #define NAU_RESET_CMD  0x0000 // Can write any data to reset address to reset all registers
@@ -20,15 +21,46 @@
 
 #define NAU_PGA_GAIN_ADDR   0x2D
 #define NAU_PGA_GAIN_CMD    0x0032   // 35.25 dB of PGA gain at the MIC input
+#define NAU_PGA_ZC          0x0080   // PGAZC, gain changes wait for a zero crossing
 
 #define NAU_ADC_CTRL_ADDR   0x0E
 #define NAU_ADC_CTRL_CMD    0x0000  // Turn off HPF?
 
 #define NAU_CLK_CTRL_ADDR   0x06
 #define NAU_CLK_CTRL_CMD    0x0020   // Divide MCLK by 1.5, bypass PLL, in slave mode
+#define NAU_CLK_CTRL_CLKM   0x0100   // IMCLK from the PLL instead of MCLK
+#define NAU_CLK_CTRL_MCLKSEL 0x00E0
+
+#define NAU_CLK_CTRL2_ADDR  0x07
+#define NAU_CLK_CTRL2_SMPLR 0x000E   // Sample rate the digital filters are set up for
+
+#define NAU_AUDIO_IF_ADDR   0x04
+#define NAU_AUDIO_IF_WLEN   0x0060   // 16, 20, 24 or 32 bit words
+
+#define NAU_CLK_BAD_FORMAT  0x11     // setClocking() error, rate or word length the codec can't do
 
 #define NAU_EQ_CTRL1_ADDR   0x12
 #define NAU_EQ_CTRL1_CMD    0x002C
+#define NAU_EQ_DAC_PATH     0x0100  // EQM in EQ1, EQ runs on the DAC path instead of the ADC path
+#define NAU_EQ_WIDE         0x0100  // EQ2 - EQ4 bandwidth
+#define NAU_EQ_FREQ         0x0060  // Cut-off/centre frequency select, see NAU8810::eqFrequency()
+#define NAU_EQ_GAIN         0x001F  // 0 is +12 dB, 24 is -12 dB
+#define NAU_EQ_BANDS        5
+
+#define NAU_DAC_LIM1_ADDR   0x18
+#define NAU_DAC_LIM_EN      0x0100
+#define NAU_DAC_LIM2_ADDR   0x19
+
+#define NAU_NOTCH1_ADDR     0x1B    // Four registers, 7 coefficient bits each
+#define NAU_NOTCH_UPDATE    0x0100  // Latches all four registers, set on the last one
+#define NAU_NOTCH_EN        0x0080
+
+#define NAU_ALC_EN          0x0100
+#define NAU_ALC_ZC          0x0100  // ALCZC in ALC2, ALC gain steps wait for a zero crossing
+#define NAU_ALC3_ADDR       0x22
+#define NAU_ALC_LIMITER     0x0100  // ALCM, limiter mode instead of normal ALC
+#define NAU_NOISE_GATE_ADDR 0x23
+#define NAU_NOISE_GATE_EN   0x0008
 
 // try preemphasis
 
@@ -42,6 +74,7 @@
 
 #define NAU_SPEAKER_GAIN_ADDR 0x36
 #define NAU_SPEAKER_GAIN_CMD  0x003F    // +6 dB of speaker gain
+#define NAU_SPEAKER_ZC        0x0080    // SPKZC, volume changes wait for a zero crossing
 
 #define NAU_ALC1_CTRL_ADDR  0x20
 #define NAU_ALC1_CTRL_CMD   0x138   // Enable ALC, max max gain and min min gain
@@ -53,31 +86,125 @@
 
 #define NAU_DAC_CTRL_ADDR   0x0A
 #define NAU_DAC_CTRL_CMD    0x0030  // Turn on de-emphasis
+#define NAU_DAC_SOFTMUTE    0x0040  // DACMT, ramps the DAC output down instead of cutting it
+#define NAU_DAC_DEEMP       0x0030  // De-emphasis filter, 32 / 44.1 / 48 kHz or off
 
 
 #define NAU_PLL1_ADDR 0x24
 #define NAU_PLL2_ADDR 0x25
 #define NAU_PLL3_ADDR 0x26
 #define NAU_PLL4_ADDR 0x27
+#define NAU_PLL_PRESCALE    0x0010  // PLLMCLK, halves MCLK in front of the PLL
+
+#define NAU_PLL_F2_MIN      90000000    // PLL output (f2) has to stay inside this range
+#define NAU_PLL_F2_MAX      100000000
+#define NAU_PLL_N_MIN       6
+#define NAU_PLL_N_MAX       12
+#define NAU_PLL_K_BITS      24
+#define NAU_PLL_NO_SOLUTION 0x10        // setPLL() error, above the Wire error codes
+
+#define NAU_IMCLK_48K       12288000    // 256 fs for the 8/16/32/48 kHz family
+#define NAU_IMCLK_44K1      11289600    // 256 fs for 11.025/22.05/44.1 kHz
+
+#define NAU_NUM_REGS  0x50  // Register map runs from 0x00 to 0x4F
+
+#define NAU_BAD_PARAM       0x12        // A DSP setter argument is out of range, nothing written
+
+#define NAU_TXN_SOFT_MUTE   0x01        // Ramp the DAC down around the commit
+#define NAU_TXN_ZERO_CROSS  0x02        // Staged gain registers get their zero-cross bit
+#define NAU_SOFTMUTE_MS     20          // DAC soft-mute ramp allowed before a muted commit goes out
+
+#define NAU_PROFILE_OK 0xFF // failedEntry value when every write in a profile landed
 
 
+// One register write in an init profile
+struct NAU8810RegWrite {
+    uint8_t reg;
+    uint16_t value;
+};
+
+// A list of register writes applied in order, e.g. at power-up
+struct NAU8810Profile {
+    const NAU8810RegWrite *writes;
+    uint8_t length;
+};
+
+// PLL settings found by NAU8810::solvePLL(). IMCLK = f2 / (4 * MCLKSEL divider),
+// f2 = MCLK / prescale * (N + K / 2^24).
+struct NAU8810PLLConfig {
+    uint8_t prescale;       // 1 or 2
+    uint8_t mclkSel;        // CLK control MCLKSEL field, divider 1, 1.5, 2, 3, 4, 6, 8 or 12
+    uint8_t n;
+    uint32_t k;             // 24-bit fraction
+    uint32_t f2;            // Target PLL output, Hz
+    uint32_t imclk;         // IMCLK actually produced, Hz rounded
+    int32_t errorPpb;       // Achieved versus requested IMCLK, parts per billion
+};
+
+extern const NAU8810Profile NAU_PROFILE_DEFAULT;        // Reset, power up, ADC-to-DAC loopback, ALC on, de-emphasis
+extern const NAU8810Profile NAU_PROFILE_PGA_INPUT;      // Mic PGA front end: +35.25 dB, negative input disconnected, HPF off
+extern const NAU8810Profile NAU_PROFILE_ANALOG_BYPASS;  // Analog bypass straight to the speaker with +6 dB gain
+extern const NAU8810Profile NAU_PROFILE_EQ_ADC_PATH;    // EQ block moved to the ADC path
+
 class NAU8810 {
     public:
         NAU8810( int ADDR, TwoWire *i2c_wire );
-        uint8_t begin();
-        uint16_t readRegister( uint8_t reg );
+        uint8_t begin( uint8_t *failedEntry = NULL );
+        void setInitProfile( const NAU8810Profile *profile );   // Applied by begin() on top of NAU_PROFILE_DEFAULT, NULL for none
+        uint8_t applyProfile( const NAU8810Profile *profile, uint8_t *failedEntry = NULL );
+        uint16_t readRegister( uint8_t reg );           // Served from the shadow copy, no bus traffic
+        uint16_t readRegisterFromDevice( uint8_t reg ); // Always goes out on I2C
         uint8_t setSpeakerVolume( uint8_t volume );
-        uint8_t setPLL(uint32_t inputFreq);
+        uint8_t setPLL( uint32_t mclk, uint32_t imclk = NAU_IMCLK_48K, NAU8810PLLConfig *config = NULL );
+        static uint8_t solvePLL( uint32_t mclk, uint32_t imclk, NAU8810PLLConfig *config );
+        uint8_t setClocking( uint32_t mclk, uint32_t sampleRate, uint8_t wordLength, NAU8810PLLConfig *pll = NULL );
         uint8_t setALCGain(uint8_t volume);
         uint8_t writeToRegister( uint8_t reg, uint16_t value );
+        uint8_t updateRegister( uint8_t reg, uint16_t mask, uint16_t value );
         uint8_t setEQGain(uint8_t band, uint8_t volume);
+        uint8_t setEQBand( uint8_t band, uint8_t freq, bool wide = false );
+        uint8_t setEQPath( bool dac );
+        static uint16_t eqFrequency( uint8_t band, uint8_t freq );
+
+        // DSP blocks. Timing and level arguments are the datasheet register
+        // codes, the setters range check them and leave the other bits alone.
+        uint8_t setNotch( uint32_t sampleRate, uint32_t centreHz, uint32_t bandwidthHz );
+        uint8_t setNotchCoefficients( int16_t a0, int16_t a1, bool enable = true );
+        uint8_t disableNotch();
+        uint8_t setDACLimiter( bool enable, uint8_t threshold = 0, uint8_t boost = 0 );
+        uint8_t setDACLimiterTiming( uint8_t attack, uint8_t decay );
+        uint8_t setALC( bool enable, uint8_t minGain = 0, uint8_t maxGain = 7 );
+        uint8_t setALCTiming( uint8_t hold, uint8_t attack, uint8_t decay, bool limiterMode = false );
+        uint8_t setNoiseGate( bool enable, uint8_t threshold = 0 );
         uint8_t setOutput(uint8_t output);
 
+        // While staging, writes only land in the shadow copy. commitStaged() then
+        // sends every changed register back-to-back in address order; a register
+        // that fails stays staged so the commit can be retried.
+        void beginStaging();
+        uint8_t commitStaged( uint8_t *failedReg = NULL );
+
+        // A staged batch for one user action. Transactions nest, and inside
+        // someone else's staging they only add to that batch. The outermost
+        // commit optionally soft-mutes the DAC around the writes.
+        void beginTransaction( uint8_t flags = 0 );
+        uint8_t commitTransaction( uint8_t *failedReg = NULL );
+
     private:
         int _addr;
         TwoWire *_wire;
-        
-        
+        const NAU8810Profile *_initProfile;     // Extra profile after the default one, NULL for none
+        uint16_t _regs[NAU_NUM_REGS];   // Shadow copy of every 9-bit register, writes only go out when a value changes
+        bool _staging;
+        uint8_t _staged[(NAU_NUM_REGS + 7) / 8];    // Registers whose shadow value hasn't reached the chip yet
+        uint8_t _txnDepth;
+        uint8_t _txnFlags;
+        bool _txnOwnsStaging;   // Outermost transaction started the staging, so it commits
+
+        void resetShadow();
+        void forceStage( uint8_t reg, uint16_t value );
+        uint8_t busWrite( uint8_t reg, uint16_t value );
+        bool isStaged( uint8_t reg ) { return _staged[reg >> 3] & (1 << (reg & 7)); }
 };
 
 
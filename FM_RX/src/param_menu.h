@@ -0,0 +1,114 @@
+#ifndef PARAM_MENU_h
+#define PARAM_MENU_h
+
+#include <Arduino.h>
+#include <nau8810.h>
+#include <display_ui.h>
+
+// How a knob turn changes a parameter
+#define PARAM_RANGE     0   // Steps through min..max and stops at the ends
+#define PARAM_TOGGLE    1   // Any movement flips between min and max
+
+// Pushes a value to the codec. requested is where the knob tried to go
+// before clamping, so a setter can act on being pushed past the end.
+typedef uint8_t (*ParamSetter)( NAU8810 *codec, int8_t value, int16_t requested );
+
+// One ROT2 page: where the value lives, how the knob moves it, how it gets to
+// the codec and how it is drawn. Tables of these are const and live in flash.
+struct ParamDesc {
+    const char *label;          // Highlighted while the page is selected, e.g. "Vol:"
+    int8_t *value;
+    int8_t min;
+    int8_t max;
+    int8_t step;                // Per detent, negative turns the knob around
+    uint8_t kind;               // PARAM_RANGE or PARAM_TOGGLE
+    ParamSetter apply;
+    int8_t shownBase;           // Printed as shownBase + shownScale * value...
+    int8_t shownScale;
+    const char *const *choices; // ...or as choices[value - min] when set
+    UIFieldBox box;
+};
+
+// Setter for any NAU8810 member that takes just the value
+template<uint8_t (NAU8810::*SETTER)( uint8_t )>
+uint8_t codecSetter(NAU8810 *codec, int8_t value, int16_t)
+{
+    return (codec->*SETTER)(value);
+}
+
+// Setter for one band of a banded control, e.g. setEQGain(BAND, value)
+template<uint8_t (NAU8810::*SETTER)( uint8_t, uint8_t ), uint8_t BAND>
+uint8_t codecBandSetter(NAU8810 *codec, int8_t value, int16_t)
+{
+    return (codec->*SETTER)(BAND, value);
+}
+
+// Walks a parameter table with ROT2: press moves to the next page, turning
+// changes the selected value. Only that one parameter is written and, through
+// UIState, redrawn. Nothing is allocated, the size comes from the table.
+template<uint8_t N>
+class ParamMenu {
+    static_assert(N > 0 && N <= UI_MAX_PARAMS, "UIState carries at most UI_MAX_PARAMS pages");
+
+    public:
+        ParamMenu( const ParamDesc (&table)[N], NAU8810 *codec ) : _table(table), _codec(codec), _selected(0) {}
+
+        const ParamDesc *table() { return _table; }
+        uint8_t size() { return N; }
+        uint8_t selected() { return _selected; }
+        void select( uint8_t index ) { _selected = index < N ? index : 0; }
+        void next() { _selected = (_selected + 1) % N; }
+
+        // Returns true if the selected value changed or hit an end
+        bool turn( int16_t detents )
+        {
+            if (!detents)
+            {
+                return false;
+            }
+            const ParamDesc *param = &_table[_selected];
+            int16_t requested;
+            if (param->kind == PARAM_TOGGLE)
+            {
+                requested = *param->value == param->min ? param->max : param->min;
+            }
+            else
+            {
+                requested = *param->value + detents * param->step;
+            }
+            int8_t value = constrain(requested, (int16_t)param->min, (int16_t)param->max);
+            if (value == *param->value && value == requested)
+            {
+                return false;
+            }
+            *param->value = value;
+            param->apply(_codec, value, requested);
+            return true;
+        }
+
+        // Sends every value to the codec, e.g. inside a staged batch at boot
+        uint8_t applyAll()
+        {
+            uint8_t err = 0;
+            for (uint8_t i = 0; i < N; i++)
+            {
+                err |= _table[i].apply(_codec, *_table[i].value, *_table[i].value);
+            }
+            return err;
+        }
+
+        void snapshot( int8_t *values )
+        {
+            for (uint8_t i = 0; i < N; i++)
+            {
+                values[i] = *_table[i].value;
+            }
+        }
+
+    private:
+        const ParamDesc (&_table)[N];
+        NAU8810 *_codec;
+        uint8_t _selected;
+};
+
+#endif
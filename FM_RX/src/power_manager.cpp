@@ -0,0 +1,147 @@
+#include <power_manager.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+PowerManager::PowerManager(DisplayUI *ui)
+{
+    _ui = ui;
+    _numWakePins = 0;
+    _edgeMask = 0;
+    _dimTimeout = POWER_DIM_TIMEOUT;
+    _offTimeout = POWER_OFF_TIMEOUT;
+    _standbyTimeout = POWER_STANDBY_TIMEOUT;
+    _lastActivity = 0;
+    _state = POWER_ACTIVE;
+}
+
+// Lets the CPU clock drop whenever no task needs it. The I2S driver holds its
+// own NO_LIGHT_SLEEP lock while it runs off the APLL, which keeps MCLK to the
+// codec alive, so automatic light sleep is left off. Returns 0 on success, 1 if
+// power management isn't enabled in this build (the radio then just runs at
+// maxCpuMhz) or 2 for too many wake pins.
+uint8_t PowerManager::begin(uint16_t maxCpuMhz, const uint8_t *wakePins, uint8_t numWakePins, uint8_t edgeMask)
+{
+    if (numWakePins > POWER_MAX_WAKE_PINS)
+    {
+        return 2;
+    }
+    memcpy(_wakePins, wakePins, numWakePins);
+    _numWakePins = numWakePins;
+    _edgeMask = edgeMask;
+    _lastActivity = millis();
+
+    esp_pm_config_esp32s3_t pm_config;
+    pm_config.max_freq_mhz = maxCpuMhz;
+    pm_config.min_freq_mhz = POWER_MIN_CPU_MHZ;
+    pm_config.light_sleep_enable = false;
+    if (esp_pm_configure(&pm_config) != ESP_OK)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+void PowerManager::setTimeouts(uint32_t dimMs, uint32_t offMs, uint32_t standbyMs)
+{
+    _dimTimeout = dimMs;
+    _offTimeout = offMs;
+    _standbyTimeout = standbyMs;
+}
+
+void PowerManager::setState(uint8_t state)
+{
+    if (state == _state)
+    {
+        return;
+    }
+
+    // Through DisplayUI, so the commands can't interleave with a flush on core 0
+    if (state == POWER_ACTIVE)
+    {
+        _ui->setPower(UI_POWER_ON);
+    }
+    else if (state == POWER_DIM)
+    {
+        _ui->setPower(UI_POWER_DIM);
+    }
+    else if (state == POWER_DISPLAY_OFF && _state < POWER_DISPLAY_OFF)
+    {
+        _ui->setPower(UI_POWER_OFF);
+    }
+    _state = state;
+}
+
+bool PowerManager::activity()
+{
+    bool woke = _state >= POWER_DISPLAY_OFF;
+    _lastActivity = millis();
+    setState(POWER_ACTIVE);
+    return woke;
+}
+
+uint8_t PowerManager::update()
+{
+    uint32_t idle = millis() - _lastActivity;
+
+    if (_standbyTimeout && idle >= _standbyTimeout)
+    {
+        setState(POWER_STANDBY);
+    }
+    else if (_offTimeout && idle >= _offTimeout)
+    {
+        setState(POWER_DISPLAY_OFF);
+    }
+    else if (_dimTimeout && idle >= _dimTimeout)
+    {
+        setState(POWER_DIM);
+    }
+    return _state;
+}
+
+// Level wakeup only, so each pin is armed for the opposite of where it sits
+// now. Wakeup also takes over the pin's interrupt type, the edge interrupt is
+// masked first so the level doesn't storm the ISR once awake.
+void PowerManager::armWakePins()
+{
+    for (uint8_t i = 0; i < _numWakePins; i++)
+    {
+        gpio_num_t pin = (gpio_num_t)_wakePins[i];
+        gpio_intr_disable(pin);
+        gpio_wakeup_enable(pin, digitalRead(pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    }
+    esp_sleep_enable_gpio_wakeup();
+}
+
+// Puts back the edge interrupts attachInterrupt() set up. Encoder pins belong
+// to PCNT and are left with their GPIO interrupt disabled, as before.
+void PowerManager::disarmWakePins()
+{
+    for (uint8_t i = 0; i < _numWakePins; i++)
+    {
+        gpio_num_t pin = (gpio_num_t)_wakePins[i];
+        gpio_wakeup_disable(pin);
+        if (_edgeMask & (1 << i))
+        {
+            gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE);
+            gpio_intr_enable(pin);
+        }
+    }
+}
+
+// Blocks in light sleep until a knob or button moves. The caller must stop
+// I2S first, otherwise its PM lock keeps the chip awake.
+void PowerManager::standby()
+{
+    if (_state < POWER_DISPLAY_OFF)
+    {
+        _ui->setPower(UI_POWER_OFF);
+    }
+    _state = POWER_STANDBY;
+
+    armWakePins();
+    esp_light_sleep_start();
+    disarmWakePins();
+
+    activity();
+}
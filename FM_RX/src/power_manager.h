@@ -0,0 +1,52 @@
+#ifndef POWER_MANAGER_h
+#define POWER_MANAGER_h
+
+#include <Arduino.h>
+#include <display_ui.h>
+
+#define POWER_MIN_CPU_MHZ       40      // XTAL, what DFS drops to while loop() is blocked
+#define POWER_MAX_WAKE_PINS     8
+
+// Inactivity timeouts in ms, 0 disables that stage
+#define POWER_DIM_TIMEOUT       15000
+#define POWER_OFF_TIMEOUT       60000
+#define POWER_STANDBY_TIMEOUT   1800000 // Sleep timer, stops audio when it fires
+
+enum PowerState {
+    POWER_ACTIVE,
+    POWER_DIM,              // Panel at minimum contrast
+    POWER_DISPLAY_OFF,      // Panel off, audio still running
+    POWER_STANDBY           // Caller should stop audio and call standby()
+};
+
+// Steps the radio down as it sits untouched. Light sleep gates the APLL and
+// I2S clocks, so while audio runs the savings come from DFS and the panel;
+// full light sleep only happens in standby, with audio stopped.
+class PowerManager {
+    public:
+        PowerManager( DisplayUI *ui );
+        // Bit i of edgeMask marks wakePins[i] as having a CHANGE interrupt attached
+        uint8_t begin( uint16_t maxCpuMhz, const uint8_t *wakePins, uint8_t numWakePins, uint8_t edgeMask );
+        void setTimeouts( uint32_t dimMs, uint32_t offMs, uint32_t standbyMs );
+        bool activity();                // Any user input, returns true if the panel was woken
+        uint8_t update();               // Call every loop() pass, returns the current state
+        void standby();                 // Light sleeps until a wake pin changes
+        uint8_t state() { return _state; }
+
+    private:
+        void setState( uint8_t state );
+        void armWakePins();
+        void disarmWakePins();
+
+        DisplayUI *_ui;
+        uint8_t _wakePins[POWER_MAX_WAKE_PINS];
+        uint8_t _numWakePins;
+        uint8_t _edgeMask;
+        uint32_t _dimTimeout;
+        uint32_t _offTimeout;
+        uint32_t _standbyTimeout;
+        uint32_t _lastActivity;         // millis()
+        uint8_t _state;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include <settings_store.h>
+
+#define SETTINGS_KEY_RADIO      "radio"
+#define SETTINGS_KEY_PRESETS    "presets"
+
+SettingsStore::SettingsStore()
+{
+    _open = false;
+    _pending = false;
+    _changedAt = 0;
+    _writes = 0;
+    memset(&_settings, 0, sizeof(_settings));
+    memset(&_presets, 0, sizeof(_presets));
+    memset(&_storedSettings, 0, sizeof(_storedSettings));
+    memset(&_storedPresets, 0, sizeof(_storedPresets));
+}
+
+// settings and presets come in holding the compile-time defaults and are only
+// overwritten by a stored copy of the right size and version
+uint8_t SettingsStore::begin(RadioSettings *settings, StationPresets *presets)
+{
+    uint8_t loaded = 0;
+    settings->version = SETTINGS_VERSION;
+    memset(settings->reserved, 0, sizeof(settings->reserved));
+    presets->version = PRESETS_VERSION;
+    memset(presets->reserved, 0, sizeof(presets->reserved));
+
+    _open = _prefs.begin(SETTINGS_NAMESPACE, false);
+    if (_open)
+    {
+        RadioSettings stored;
+        if (_prefs.getBytesLength(SETTINGS_KEY_RADIO) == sizeof(stored) &&
+            _prefs.getBytes(SETTINGS_KEY_RADIO, &stored, sizeof(stored)) == sizeof(stored) &&
+            stored.version == SETTINGS_VERSION)
+        {
+            memcpy(settings, &stored, sizeof(stored));
+            loaded |= SETTINGS_LOADED_RADIO;
+        }
+        StationPresets storedPresets;
+        if (_prefs.getBytesLength(SETTINGS_KEY_PRESETS) == sizeof(storedPresets) &&
+            _prefs.getBytes(SETTINGS_KEY_PRESETS, &storedPresets, sizeof(storedPresets)) == sizeof(storedPresets) &&
+            storedPresets.version == PRESETS_VERSION)
+        {
+            memcpy(presets, &storedPresets, sizeof(storedPresets));
+            loaded |= SETTINGS_LOADED_PRESETS;
+        }
+    }
+
+    // Whatever isn't in flash yet counts as already stored, the first write
+    // happens when something is actually changed
+    memcpy(&_settings, settings, sizeof(_settings));
+    memcpy(&_presets, presets, sizeof(_presets));
+    memcpy(&_storedSettings, settings, sizeof(_storedSettings));
+    memcpy(&_storedPresets, presets, sizeof(_storedPresets));
+    _pending = false;
+    return loaded;
+}
+
+void SettingsStore::update(const RadioSettings *settings, const StationPresets *presets)
+{
+    if (memcmp(settings, &_settings, sizeof(_settings)) || memcmp(presets, &_presets, sizeof(_presets)))
+    {
+        memcpy(&_settings, settings, sizeof(_settings));
+        memcpy(&_presets, presets, sizeof(_presets));
+        _changedAt = millis();
+        _pending = true;
+        return;
+    }
+
+    if (_pending && millis() - _changedAt >= SETTINGS_COMMIT_DELAY)
+    {
+        commit();
+    }
+}
+
+uint8_t SettingsStore::flush()
+{
+    return _pending ? commit() : 0;
+}
+
+// Spinning a knob away and back again ends with nothing to write
+uint8_t SettingsStore::commit()
+{
+    if (!_open)
+    {
+        return 1;
+    }
+
+    uint8_t err = 0;
+    if (memcmp(&_settings, &_storedSettings, sizeof(_settings)))
+    {
+        if (_prefs.putBytes(SETTINGS_KEY_RADIO, &_settings, sizeof(_settings)) == sizeof(_settings))
+        {
+            memcpy(&_storedSettings, &_settings, sizeof(_settings));
+            _writes++;
+        }
+        else
+        {
+            err = 2;
+        }
+    }
+    if (memcmp(&_presets, &_storedPresets, sizeof(_presets)))
+    {
+        if (_prefs.putBytes(SETTINGS_KEY_PRESETS, &_presets, sizeof(_presets)) == sizeof(_presets))
+        {
+            memcpy(&_storedPresets, &_presets, sizeof(_presets));
+            _writes++;
+        }
+        else
+        {
+            err = 2;
+        }
+    }
+    _pending = err != 0;    // A failed write is retried after the next quiet period
+    if (_pending)
+    {
+        _changedAt = millis();
+    }
+    return err;
+}
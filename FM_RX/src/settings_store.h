@@ -0,0 +1,62 @@
+#ifndef SETTINGS_STORE_h
+#define SETTINGS_STORE_h
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#define SETTINGS_NAMESPACE      "fmrx"
+#define SETTINGS_VERSION        1       // Bump when RadioSettings changes layout, old blobs are then ignored
+#define PRESETS_VERSION         1       // Same for StationPresets
+#define SETTINGS_COMMIT_DELAY   5000    // ms the state has to sit still before it is written to flash
+#define SETTINGS_NUM_PRESETS    8
+
+// Everything the knobs can change that should survive a power cycle. Kept
+// free of implicit padding between fields so it can be compared with memcmp.
+struct RadioSettings {
+    uint64_t pll_freq;      // LO frequency, Hz
+    uint8_t version;
+    int8_t volume;
+    int8_t alc;
+    int8_t eq_gain[5];
+    uint8_t audio_output;
+    uint8_t lo_select;
+    uint8_t reserved[6];
+};
+
+struct StationPresets {
+    uint32_t freq[SETTINGS_NUM_PRESETS];    // Tuned frequency in Hz, 0 for an empty slot
+    uint8_t version;
+    uint8_t reserved[3];
+};
+
+// Keeps the settings and presets in NVS. update() is called with the live
+// state on every loop pass, and flash is only written once that state has
+// stayed the same for SETTINGS_COMMIT_DELAY, so a fast knob spin costs a
+// single write. Settings and presets are separate keys and only the one that
+// actually differs from flash is rewritten.
+class SettingsStore {
+    public:
+        SettingsStore();
+        uint8_t begin( RadioSettings *settings, StationPresets *presets );  // Fills in whatever was stored, returns the SETTINGS_LOADED_* bits. Values aren't range checked.
+        void update( const RadioSettings *settings, const StationPresets *presets );
+        uint8_t flush();        // Writes anything still pending now, returns 0 on success
+        uint32_t writes() { return _writes; }
+
+    private:
+        uint8_t commit();
+
+        Preferences _prefs;
+        bool _open;
+        bool _pending;          // Live state differs from what was seen last pass or from flash
+        uint32_t _changedAt;    // millis() of the last change seen by update()
+        uint32_t _writes;
+        RadioSettings _settings;        // Latest state handed to update()
+        StationPresets _presets;
+        RadioSettings _storedSettings;  // What flash holds
+        StationPresets _storedPresets;
+};
+
+#define SETTINGS_LOADED_RADIO   0x01
+#define SETTINGS_LOADED_PRESETS 0x02
+
+#endif
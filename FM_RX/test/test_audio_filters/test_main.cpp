@@ -0,0 +1,272 @@
+// Fixed-point filter kernels against a double-precision scalar reference
+
+#include <Arduino.h>
+#include <math.h>
+#include <unity.h>
+#include <audio_filters.h>
+
+#define BLOCK   256
+
+static int32_t block[BLOCK];
+static int32_t expected[BLOCK];
+
+void setUp()
+{
+    memset(block, 0, sizeof(block));
+    memset(expected, 0, sizeof(expected));
+}
+
+void tearDown()
+{
+}
+
+// Same direct form I and the same quantized coefficients, in doubles. The
+// samples go in with the kernel's headroom shift and the rounded output is
+// fed back the same way, so the two have to agree bit for bit.
+static void referenceBiquad(const BiquadCoeffs *c, const int32_t *in, int32_t *out, uint16_t count)
+{
+    const double scale = 1.0 / (1L << (BIQUAD_Q31_SHIFT - BIQUAD_HEADROOM));
+    double b0 = c->b0 * scale, b1 = c->b1 * scale, b2 = c->b2 * scale;
+    double a1 = c->a1 * scale, a2 = c->a2 * scale;
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        double x = in[i] >> BIQUAD_HEADROOM;
+        double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        y = floor(y + 0.5);
+        if (y > INT32_MAX)
+        {
+            y = INT32_MAX;
+        }
+        if (y < INT32_MIN)
+        {
+            y = INT32_MIN;
+        }
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = (int32_t)y >> BIQUAD_HEADROOM;
+        out[i] = (int32_t)y;
+    }
+}
+
+static void assertMatchesReference(const BiquadCoeffs *c)
+{
+    int32_t input[BLOCK];
+    memcpy(input, block, sizeof(input));
+    referenceBiquad(c, input, expected, BLOCK);
+
+    // Two calls, so the state carried between blocks is covered too
+    BiquadQ31 biquad;
+    TEST_ASSERT_TRUE(biquad.setCoeffs(c));
+    biquad.process(block, BLOCK / 2);
+    biquad.process(&block[BLOCK / 2], BLOCK / 2);
+    for (uint16_t i = 0; i < BLOCK; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32(expected[i], block[i]);
+    }
+}
+
+// BIQUAD
+
+void test_default_biquad_passes_through()
+{
+    // 24-bit samples, MSB aligned as the pipeline carries them
+    for (uint16_t i = 0; i < BLOCK; i++)
+    {
+        block[i] = (int32_t)(i * 0x01234567UL) & ~0xFF;
+    }
+    memcpy(expected, block, sizeof(block));
+    BiquadQ31 biquad;
+    biquad.process(block, BLOCK);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(expected, block, BLOCK);
+}
+
+void test_lowpass_impulse_response()
+{
+    BiquadCoeffs c;
+    designLowPass(&c, 48000, 15000.0f, 0.7071f);
+    block[0] = 0x40000000;
+    assertMatchesReference(&c);
+}
+
+void test_notch_impulse_response()
+{
+    BiquadCoeffs c;
+    designNotch(&c, 48000, 19000.0f, 8.0f);
+    block[0] = -0x40000000;
+    assertMatchesReference(&c);
+}
+
+void test_lowpass_step_response()
+{
+    BiquadCoeffs c;
+    designLowPass(&c, 48000, 1000.0f, 0.7071f);
+    for (uint16_t i = 0; i < BLOCK; i++)
+    {
+        block[i] = 0x20000000;
+    }
+    assertMatchesReference(&c);
+
+    // Unity DC gain, settled by the end of the block
+    TEST_ASSERT_INT32_WITHIN(0x1000, 0x20000000, block[BLOCK - 1]);
+}
+
+void test_deemphasis_step_response()
+{
+    BiquadCoeffs c;
+    designDeemphasis(&c, 48000, DEEMPHASIS_EU_US);
+    TEST_ASSERT_EQUAL_INT32(0, c.b2);
+    TEST_ASSERT_EQUAL_INT32(0, c.a2);
+    for (uint16_t i = 0; i < BLOCK; i++)
+    {
+        block[i] = -0x30000000;
+    }
+    assertMatchesReference(&c);
+    TEST_ASSERT_INT32_WITHIN(0x1000, -0x30000000, block[BLOCK - 1]);
+}
+
+void test_highpass_rejects_dc()
+{
+    BiquadCoeffs c;
+    designHighPass(&c, 48000, 200.0f, 0.7071f);
+    for (uint16_t i = 0; i < BLOCK; i++)
+    {
+        block[i] = 0x10000000;
+    }
+    assertMatchesReference(&c);
+    TEST_ASSERT_INT32_WITHIN(0x01000000, 0, block[BLOCK - 1]);
+}
+
+void test_biquad_saturates_at_full_scale()
+{
+    // Gain just under 2 on a full-scale input clamps rather than wrapping
+    BiquadCoeffs c = { INT32_MAX, 0, 0, 0, 0 };
+    block[0] = INT32_MAX;
+    block[1] = INT32_MIN;
+    block[2] = 0x50000000;
+    block[3] = -0x50000000;
+    block[4] = 0x20000000;
+    BiquadQ31 biquad;
+    biquad.setCoeffs(&c);
+    biquad.process(block, 5);
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, block[0]);
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, block[1]);
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, block[2]);
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, block[3]);
+    TEST_ASSERT_EQUAL_INT32(0x40000000, block[4]);     // 2^30 - 0.5, rounded
+}
+
+void test_resonant_overshoot_clamps()
+{
+    // A high-Q low-pass rings past a full-scale step, wrapping would flip the sign
+    BiquadCoeffs c;
+    designLowPass(&c, 48000, 2000.0f, 8.0f);
+    for (uint16_t i = 0; i < BLOCK; i++)
+    {
+        block[i] = i < BLOCK / 2 ? INT32_MAX : INT32_MIN;
+    }
+    assertMatchesReference(&c);
+
+    bool clipped = false;
+    for (uint16_t i = 0; i < BLOCK / 2; i++)
+    {
+        TEST_ASSERT_TRUE(block[i] >= 0);
+        clipped |= block[i] == INT32_MAX;
+    }
+    TEST_ASSERT_TRUE(clipped);
+    TEST_ASSERT_TRUE(block[BLOCK / 2 + 8] < 0);
+}
+
+void test_chain_equals_sections_in_series()
+{
+    BiquadCoeffs notch, lowPass;
+    designNotch(&notch, 48000, 19000.0f, 8.0f);
+    designLowPass(&lowPass, 48000, 15000.0f, 0.7071f);
+    for (uint16_t i = 0; i < BLOCK; i++)
+    {
+        block[i] = (int32_t)(sinf(i * 0.37f) * 0x30000000);
+    }
+    memcpy(expected, block, sizeof(block));
+
+    BiquadQ31 first, second;
+    first.setCoeffs(&notch);
+    second.setCoeffs(&lowPass);
+    first.process(expected, BLOCK);
+    second.process(expected, BLOCK);
+
+    FilterChain chain;
+    TEST_ASSERT_TRUE(chain.addSection(&notch));
+    TEST_ASSERT_TRUE(chain.addSection(&lowPass));
+    FilterChain::stage(block, BLOCK, &chain);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(expected, block, BLOCK);
+
+    for (uint8_t i = 2; i < FILTER_MAX_SECTIONS; i++)
+    {
+        TEST_ASSERT_TRUE(chain.addSection(&notch));
+    }
+    TEST_ASSERT_FALSE(chain.addSection(&notch));
+}
+
+void test_full_scale_coefficients_do_not_wrap()
+{
+    // Every coefficient at its Q2.30 limit with a pole pair just inside the
+    // unit circle. Without headroom three full-scale products alone pass 2^63.
+    BiquadCoeffs c = { INT32_MIN, INT32_MIN, INT32_MIN, -(INT32_MAX - 1), (1L << BIQUAD_Q31_SHIFT) - 1 };
+    for (uint16_t i = 0; i < 16; i++)
+    {
+        block[i] = INT32_MIN;
+    }
+    BiquadQ31 biquad;
+    TEST_ASSERT_TRUE(biquad.setCoeffs(&c));
+    biquad.process(block, 16);
+    for (uint16_t i = 0; i < 16; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32(INT32_MAX, block[i]);
+    }
+}
+
+void test_unstable_coefficients_are_rejected()
+{
+    const int32_t one = 1L << BIQUAD_Q31_SHIFT;
+    BiquadCoeffs onCircle = { one, 0, 0, 0, one };
+    BiquadCoeffs outside = { one, 0, 0, -one, -one / 2 };
+    BiquadCoeffs gain = { one + one / 2, 0, 0, 0, 0 };
+
+    BiquadQ31 biquad;
+    TEST_ASSERT_FALSE(biquad.setCoeffs(&onCircle));
+    TEST_ASSERT_FALSE(biquad.setCoeffs(&outside));
+    block[0] = 0x10000000;
+    biquad.process(block, 1);
+    TEST_ASSERT_EQUAL_INT32(0x10000000, block[0]);     // Still passing through
+
+    // A rejected section keeps what was there before
+    TEST_ASSERT_TRUE(biquad.setCoeffs(&gain));
+    TEST_ASSERT_FALSE(biquad.setCoeffs(&onCircle));
+    biquad.process(block, 1);
+    TEST_ASSERT_EQUAL_INT32(0x18000000, block[0]);
+
+    FilterChain chain;
+    TEST_ASSERT_FALSE(chain.addSection(&outside));
+    block[0] = 0x10000000;
+    chain.process(block, 1);
+    TEST_ASSERT_EQUAL_INT32(0x10000000, block[0]);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_default_biquad_passes_through);
+    RUN_TEST(test_lowpass_impulse_response);
+    RUN_TEST(test_notch_impulse_response);
+    RUN_TEST(test_lowpass_step_response);
+    RUN_TEST(test_deemphasis_step_response);
+    RUN_TEST(test_highpass_rejects_dc);
+    RUN_TEST(test_biquad_saturates_at_full_scale);
+    RUN_TEST(test_resonant_overshoot_clamps);
+    RUN_TEST(test_chain_equals_sections_in_series);
+    RUN_TEST(test_full_scale_coefficients_do_not_wrap);
+    RUN_TEST(test_unstable_coefficients_are_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,107 @@
+// Tuning knob acceleration: multiplier levels, the window, direction
+// reversal and the step cap
+
+#include <Arduino.h>
+#include <unity.h>
+#include <encoder_accel.h>
+
+static EncoderAccel accel;
+
+void setUp()
+{
+    accel.reset();
+}
+
+void tearDown()
+{
+}
+
+void test_no_movement_is_no_change()
+{
+    TEST_ASSERT_EQUAL_INT64(0, accel.delta(0, 1000, 0));
+    TEST_ASSERT_EQUAL_UINT8(1, accel.multiplier());
+}
+
+void test_slow_turn_steps_by_the_digit()
+{
+    // One detent every 250 ms never has company in the window
+    for (uint32_t now = 1000; now < 3000; now += 250)
+    {
+        TEST_ASSERT_EQUAL_INT64(1000, accel.delta(1, 1000, now));
+        TEST_ASSERT_EQUAL_UINT8(1, accel.multiplier());
+    }
+}
+
+void test_levels_follow_detents_in_window()
+{
+    // One detent per 10 ms pass, the window fills up as the spin goes on
+    uint32_t now = 1000;
+    for (uint8_t i = 1; i <= 16; i++, now += 10)
+    {
+        int64_t change = accel.delta(1, 100, now);
+        uint8_t expected = i >= 14 ? 10 : i >= 8 ? 5 : i >= 4 ? 2 : 1;
+        TEST_ASSERT_EQUAL_UINT8(expected, accel.multiplier());
+        TEST_ASSERT_EQUAL_INT64(100 * expected, change);
+    }
+}
+
+void test_counts_detents_not_passes()
+{
+    TEST_ASSERT_EQUAL_INT64(4 * 2 * 100, accel.delta(4, 100, 1000));
+    TEST_ASSERT_EQUAL_INT64(4 * 5 * 100, accel.delta(4, 100, 1010));
+}
+
+void test_old_passes_fall_out_of_the_window()
+{
+    accel.delta(10, 100, 1000);
+    TEST_ASSERT_EQUAL_UINT8(5, accel.multiplier());
+    accel.delta(1, 100, 1000 + ACCEL_WINDOW_MS - 1);
+    TEST_ASSERT_EQUAL_UINT8(5, accel.multiplier());
+    accel.delta(1, 100, 1000 + ACCEL_WINDOW_MS);
+    TEST_ASSERT_EQUAL_UINT8(1, accel.multiplier());
+}
+
+void test_reversal_drops_to_single_steps()
+{
+    accel.delta(14, 100, 1000);
+    TEST_ASSERT_EQUAL_UINT8(10, accel.multiplier());
+    TEST_ASSERT_EQUAL_INT64(-100, accel.delta(-1, 100, 1010));
+    TEST_ASSERT_EQUAL_UINT8(1, accel.multiplier());
+    TEST_ASSERT_EQUAL_INT64(-3 * 2 * 100, accel.delta(-3, 100, 1020));
+}
+
+void test_scaled_step_is_capped()
+{
+    // x10 on the 100 kHz digit would be 1 MHz, on the 1 MHz digit 10 MHz
+    TEST_ASSERT_EQUAL_INT64(14 * 1000000LL, accel.delta(14, 100000, 1000));
+    TEST_ASSERT_EQUAL_UINT8(10, accel.multiplier());
+
+    accel.reset();
+    TEST_ASSERT_EQUAL_INT64(-14 * 1000000LL, accel.delta(-14, 1000000, 1000));
+    TEST_ASSERT_EQUAL_UINT8(1, accel.multiplier());
+
+    // A digit coarser than the cap still moves by itself
+    accel.reset();
+    TEST_ASSERT_EQUAL_INT64(14 * 10000000LL, accel.delta(14, 10000000, 1000));
+}
+
+void test_millis_wraparound()
+{
+    accel.delta(7, 100, 0xFFFFFFF0);
+    accel.delta(1, 100, 0x00000020);
+    TEST_ASSERT_EQUAL_UINT8(5, accel.multiplier());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_no_movement_is_no_change);
+    RUN_TEST(test_slow_turn_steps_by_the_digit);
+    RUN_TEST(test_levels_follow_detents_in_window);
+    RUN_TEST(test_counts_detents_not_passes);
+    RUN_TEST(test_old_passes_fall_out_of_the_window);
+    RUN_TEST(test_reversal_drops_to_single_steps);
+    RUN_TEST(test_scaled_step_is_capped);
+    RUN_TEST(test_millis_wraparound);
+    return UNITY_END();
+}
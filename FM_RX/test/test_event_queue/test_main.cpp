@@ -0,0 +1,101 @@
+// ISR to loop() event queue: ordering, overflow and index wraparound
+
+#include <Arduino.h>
+#include <unity.h>
+#include <event_queue.h>
+
+static SPSCQueue<ControlEvent, EVENT_QUEUE_SIZE> *queue;
+
+void setUp()
+{
+    queue = new SPSCQueue<ControlEvent, EVENT_QUEUE_SIZE>();
+}
+
+void tearDown()
+{
+    delete queue;
+}
+
+static bool post(uint8_t type, uint32_t time)
+{
+    ControlEvent event = { type, time };
+    return queue->push(event);
+}
+
+void test_empty_queue_pops_nothing()
+{
+    ControlEvent event;
+    TEST_ASSERT_FALSE(queue->pop(&event));
+    TEST_ASSERT_EQUAL_UINT32(0, queue->dropped());
+}
+
+void test_events_come_out_in_order()
+{
+    TEST_ASSERT_TRUE(post(EVENT_ROT1_PRESS, 10));
+    TEST_ASSERT_TRUE(post(EVENT_ROT1_TURN, 11));
+    TEST_ASSERT_TRUE(post(EVENT_ROT1_RELEASE, 12));
+
+    ControlEvent event;
+    TEST_ASSERT_TRUE(queue->pop(&event));
+    TEST_ASSERT_EQUAL_UINT8(EVENT_ROT1_PRESS, event.type);
+    TEST_ASSERT_EQUAL_UINT32(10, event.time);
+    TEST_ASSERT_TRUE(queue->pop(&event));
+    TEST_ASSERT_EQUAL_UINT8(EVENT_ROT1_TURN, event.type);
+    TEST_ASSERT_TRUE(queue->pop(&event));
+    TEST_ASSERT_EQUAL_UINT8(EVENT_ROT1_RELEASE, event.type);
+    TEST_ASSERT_EQUAL_UINT32(12, event.time);
+    TEST_ASSERT_FALSE(queue->pop(&event));
+}
+
+void test_full_queue_drops_newest()
+{
+    // One slot stays free to tell full from empty
+    for (uint8_t i = 0; i < EVENT_QUEUE_SIZE - 1; i++)
+    {
+        TEST_ASSERT_TRUE(post(EVENT_DISPLAY_TICK, i));
+    }
+    TEST_ASSERT_FALSE(post(EVENT_BUT1_PRESS, 100));
+    TEST_ASSERT_FALSE(post(EVENT_BUT1_PRESS, 101));
+    TEST_ASSERT_EQUAL_UINT32(2, queue->dropped());
+
+    ControlEvent event;
+    for (uint8_t i = 0; i < EVENT_QUEUE_SIZE - 1; i++)
+    {
+        TEST_ASSERT_TRUE(queue->pop(&event));
+        TEST_ASSERT_EQUAL_UINT8(EVENT_DISPLAY_TICK, event.type);
+        TEST_ASSERT_EQUAL_UINT32(i, event.time);
+    }
+    TEST_ASSERT_FALSE(queue->pop(&event));
+
+    // Room again once drained
+    TEST_ASSERT_TRUE(post(EVENT_BUT1_PRESS, 102));
+    TEST_ASSERT_EQUAL_UINT32(2, queue->dropped());
+}
+
+void test_indices_wrap_around()
+{
+    // Interleaved so head and tail lap the buffer several times
+    ControlEvent event;
+    for (uint32_t i = 0; i < EVENT_QUEUE_SIZE * 5; i++)
+    {
+        TEST_ASSERT_TRUE(post(EVENT_ROT2_TURN, i));
+        TEST_ASSERT_TRUE(post(EVENT_ROT2_PRESS, i));
+        TEST_ASSERT_TRUE(queue->pop(&event));
+        TEST_ASSERT_EQUAL_UINT8(EVENT_ROT2_TURN, event.type);
+        TEST_ASSERT_EQUAL_UINT32(i, event.time);
+        TEST_ASSERT_TRUE(queue->pop(&event));
+        TEST_ASSERT_EQUAL_UINT8(EVENT_ROT2_PRESS, event.type);
+    }
+    TEST_ASSERT_FALSE(queue->pop(&event));
+    TEST_ASSERT_EQUAL_UINT32(0, queue->dropped());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_queue_pops_nothing);
+    RUN_TEST(test_events_come_out_in_order);
+    RUN_TEST(test_full_queue_drops_newest);
+    RUN_TEST(test_indices_wrap_around);
+    return UNITY_END();
+}
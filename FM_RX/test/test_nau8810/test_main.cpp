@@ -0,0 +1,271 @@
+// NAU8810 driver against the mock bus: register shadow, staged commits and
+// the integer PLL solver
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <unity.h>
+#include <nau8810.h>
+
+#define CODEC_ADDR 0x1A
+
+static NAU8810 codec(CODEC_ADDR, &Wire);
+
+// Register and 9-bit value of a logged codec write
+static uint8_t loggedReg(uint32_t index)
+{
+    return Wire.transaction(index)->data[0] >> 1;
+}
+
+static uint16_t loggedValue(uint32_t index)
+{
+    const MockI2CTransaction *t = Wire.transaction(index);
+    return ((t->data[0] & 0x01) << 8) | t->data[1];
+}
+
+void setUp()
+{
+    Wire.mockSetPresent(CODEC_ADDR, true);
+    codec.begin();
+    Wire.clearLog();
+}
+
+void tearDown()
+{
+}
+
+// SHADOW
+
+void test_write_skipped_when_shadow_matches()
+{
+    TEST_ASSERT_EQUAL_UINT8(0, codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x020));
+    TEST_ASSERT_EQUAL_UINT32(1, Wire.transactionCount());
+    TEST_ASSERT_EQUAL_UINT8(NAU_SPEAKER_GAIN_ADDR, loggedReg(0));
+    TEST_ASSERT_EQUAL_HEX16(0x020, loggedValue(0));
+
+    TEST_ASSERT_EQUAL_UINT8(0, codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x020));
+    TEST_ASSERT_EQUAL_UINT32(1, Wire.transactionCount());
+    TEST_ASSERT_EQUAL_HEX16(0x020, codec.readRegister(NAU_SPEAKER_GAIN_ADDR));
+}
+
+void test_ninth_bit_goes_in_the_address_byte()
+{
+    codec.writeToRegister(NAU_EQ_CTRL1_ADDR, 0x12A);
+    TEST_ASSERT_EQUAL_UINT32(1, Wire.transactionCount());
+    TEST_ASSERT_EQUAL_HEX8((NAU_EQ_CTRL1_ADDR << 1) | 1, Wire.transaction(0)->data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x2A, Wire.transaction(0)->data[1]);
+}
+
+void test_update_register_keeps_other_bits()
+{
+    codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x0BF);
+    codec.updateRegister(NAU_SPEAKER_GAIN_ADDR, 0x03F, 0x010);
+    TEST_ASSERT_EQUAL_HEX16(0x090, codec.readRegister(NAU_SPEAKER_GAIN_ADDR));
+    TEST_ASSERT_EQUAL_HEX16(0x090, loggedValue(Wire.transactionCount() - 1));
+}
+
+void test_failed_write_leaves_shadow_alone()
+{
+    Wire.mockSetPresent(CODEC_ADDR, false);
+    TEST_ASSERT_TRUE(codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x020) != 0);
+    TEST_ASSERT_TRUE(codec.readRegister(NAU_SPEAKER_GAIN_ADDR) != 0x020);
+
+    // Once the chip answers again the same write has to go out
+    Wire.mockSetPresent(CODEC_ADDR, true);
+    Wire.clearLog();
+    TEST_ASSERT_EQUAL_UINT8(0, codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x020));
+    TEST_ASSERT_EQUAL_UINT32(1, Wire.transactionCount());
+}
+
+void test_reset_drops_shadow_to_defaults()
+{
+    codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x020);
+    codec.writeToRegister(NAU_RESET_ADDR, 0x000);
+    Wire.clearLog();
+
+    // The chip is back at its reset value, so the same write isn't a cache hit
+    codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x020);
+    TEST_ASSERT_EQUAL_UINT32(1, Wire.transactionCount());
+}
+
+// INIT PROFILES
+
+void test_optional_profile_goes_on_top_of_default()
+{
+    NAU8810 pga(CODEC_ADDR, &Wire);
+    pga.setInitProfile(&NAU_PROFILE_PGA_INPUT);
+    uint8_t failed = 0;
+    TEST_ASSERT_EQUAL_UINT8(0, pga.begin(&failed));
+    TEST_ASSERT_EQUAL_UINT8(NAU_PROFILE_OK, failed);
+
+    // Reset and power-up first, then the PGA writes
+    TEST_ASSERT_EQUAL_UINT8(NAU_RESET_ADDR, loggedReg(0));
+    TEST_ASSERT_EQUAL_UINT8(NAU_POWER1_ADDR, loggedReg(1));
+    TEST_ASSERT_EQUAL_UINT32(NAU_PROFILE_DEFAULT.length + NAU_PROFILE_PGA_INPUT.length, Wire.transactionCount());
+    TEST_ASSERT_EQUAL_UINT8(NAU_INPUT_CTRL_ADDR, loggedReg(NAU_PROFILE_DEFAULT.length));
+}
+
+void test_default_profile_is_not_applied_twice()
+{
+    NAU8810 plain(CODEC_ADDR, &Wire);
+    plain.setInitProfile(&NAU_PROFILE_DEFAULT);
+    TEST_ASSERT_EQUAL_UINT8(0, plain.begin());
+    TEST_ASSERT_EQUAL_UINT32(NAU_PROFILE_DEFAULT.length, Wire.transactionCount());
+}
+
+// STAGING
+
+void test_staged_writes_commit_in_address_order()
+{
+    codec.beginStaging();
+    codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x020);
+    codec.writeToRegister(NAU_EQ_CTRL1_ADDR, 0x101);
+    codec.updateRegister(NAU_DAC_CTRL_ADDR, NAU_DAC_SOFTMUTE, NAU_DAC_SOFTMUTE);
+    TEST_ASSERT_EQUAL_UINT32(0, Wire.transactionCount());
+    TEST_ASSERT_EQUAL_HEX16(0x020, codec.readRegister(NAU_SPEAKER_GAIN_ADDR));
+
+    uint8_t failed = 0;
+    TEST_ASSERT_EQUAL_UINT8(0, codec.commitStaged(&failed));
+    TEST_ASSERT_EQUAL_UINT8(NAU_PROFILE_OK, failed);
+    TEST_ASSERT_EQUAL_UINT32(3, Wire.transactionCount());
+    TEST_ASSERT_EQUAL_UINT8(NAU_DAC_CTRL_ADDR, loggedReg(0));
+    TEST_ASSERT_EQUAL_UINT8(NAU_EQ_CTRL1_ADDR, loggedReg(1));
+    TEST_ASSERT_EQUAL_UINT8(NAU_SPEAKER_GAIN_ADDR, loggedReg(2));
+}
+
+void test_staging_an_unchanged_value_sends_nothing()
+{
+    uint16_t current = codec.readRegister(NAU_SPEAKER_GAIN_ADDR);
+    codec.beginStaging();
+    codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, current);
+    TEST_ASSERT_EQUAL_UINT8(0, codec.commitStaged());
+    TEST_ASSERT_EQUAL_UINT32(0, Wire.transactionCount());
+}
+
+void test_failed_commit_stays_staged_for_retry()
+{
+    codec.beginStaging();
+    codec.writeToRegister(NAU_EQ_CTRL1_ADDR, 0x101);
+    codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x020);
+
+    Wire.mockSetPresent(CODEC_ADDR, false);
+    uint8_t failed = 0;
+    TEST_ASSERT_TRUE(codec.commitStaged(&failed) != 0);
+    TEST_ASSERT_EQUAL_UINT8(NAU_EQ_CTRL1_ADDR, failed);
+
+    // A repeat of a staged value isn't a cache hit, it carries the retry
+    Wire.mockSetPresent(CODEC_ADDR, true);
+    Wire.clearLog();
+    TEST_ASSERT_EQUAL_UINT8(0, codec.writeToRegister(NAU_EQ_CTRL1_ADDR, 0x101));
+    TEST_ASSERT_EQUAL_UINT32(1, Wire.transactionCount());
+
+    TEST_ASSERT_EQUAL_UINT8(0, codec.commitStaged(&failed));
+    TEST_ASSERT_EQUAL_UINT32(2, Wire.transactionCount());
+    TEST_ASSERT_EQUAL_UINT8(NAU_SPEAKER_GAIN_ADDR, loggedReg(1));
+}
+
+void test_transaction_inside_staging_joins_the_batch()
+{
+    codec.beginStaging();
+    codec.beginTransaction(NAU_TXN_SOFT_MUTE);
+    codec.writeToRegister(NAU_SPEAKER_GAIN_ADDR, 0x020);
+    TEST_ASSERT_EQUAL_UINT8(0, codec.commitTransaction());
+    TEST_ASSERT_EQUAL_UINT32(0, Wire.transactionCount());
+
+    TEST_ASSERT_EQUAL_UINT8(0, codec.commitStaged());
+    TEST_ASSERT_EQUAL_UINT32(1, Wire.transactionCount());
+}
+
+// PLL
+
+// IMCLK the register settings actually produce, in double precision
+static double pllImclk(uint32_t mclk, const NAU8810PLLConfig *pll)
+{
+    static const double div[8] = { 1, 1.5, 2, 3, 4, 6, 8, 12 };
+    double f2 = (double)mclk / pll->prescale * (pll->n + pll->k / 16777216.0);
+    return f2 / (4 * div[pll->mclkSel]);
+}
+
+void test_pll_12mhz_to_48k_family()
+{
+    NAU8810PLLConfig pll;
+    TEST_ASSERT_EQUAL_UINT8(0, NAU8810::solvePLL(12000000, NAU_IMCLK_48K, &pll));
+    TEST_ASSERT_EQUAL_UINT8(1, pll.prescale);
+    TEST_ASSERT_EQUAL_UINT8(2, pll.mclkSel);     // Divide by 2, f2 = 98.304 MHz
+    TEST_ASSERT_EQUAL_UINT8(8, pll.n);
+    TEST_ASSERT_EQUAL_UINT32(0x3126E9, pll.k);   // 0.192 * 2^24 rounded
+    TEST_ASSERT_EQUAL_UINT32(98304000, pll.f2);
+    TEST_ASSERT_EQUAL_UINT32(NAU_IMCLK_48K, pll.imclk);
+    TEST_ASSERT_INT32_WITHIN(5, 0, pll.errorPpb);
+}
+
+void test_pll_error_matches_double_reference()
+{
+    static const uint32_t mclks[] = { 12000000, 13000000, 19200000, 24000000, 26000000, 27000000 };
+    static const uint32_t imclks[] = { NAU_IMCLK_48K, NAU_IMCLK_44K1 };
+
+    for (uint8_t i = 0; i < sizeof(mclks) / sizeof(mclks[0]); i++)
+    {
+        for (uint8_t j = 0; j < 2; j++)
+        {
+            NAU8810PLLConfig pll;
+            TEST_ASSERT_EQUAL_UINT8(0, NAU8810::solvePLL(mclks[i], imclks[j], &pll));
+            TEST_ASSERT_TRUE(pll.n >= NAU_PLL_N_MIN && pll.n <= NAU_PLL_N_MAX);
+            TEST_ASSERT_TRUE(pll.k < (1UL << NAU_PLL_K_BITS));
+            TEST_ASSERT_TRUE(pll.f2 >= NAU_PLL_F2_MIN && pll.f2 <= NAU_PLL_F2_MAX);
+
+            double ppb = (pllImclk(mclks[i], &pll) / imclks[j] - 1.0) * 1e9;
+            TEST_ASSERT_INT32_WITHIN(1, (int32_t)lround(ppb), pll.errorPpb);
+            TEST_ASSERT_INT32_WITHIN(60, 0, pll.errorPpb);  // Half a K step at the largest R / MCLK
+        }
+    }
+}
+
+void test_pll_without_solution()
+{
+    NAU8810PLLConfig pll;
+    TEST_ASSERT_EQUAL_UINT8(NAU_PLL_NO_SOLUTION, NAU8810::solvePLL(1000000, NAU_IMCLK_48K, &pll));   // R above N_MAX
+    TEST_ASSERT_EQUAL_UINT8(NAU_PLL_NO_SOLUTION, NAU8810::solvePLL(0, NAU_IMCLK_48K, &pll));
+}
+
+void test_set_pll_writes_all_four_registers_in_order()
+{
+    // The default profile already holds the 48 kHz ratio, move to 44.1 kHz
+    NAU8810PLLConfig pll;
+    TEST_ASSERT_EQUAL_UINT8(0, codec.setPLL(12000000, NAU_IMCLK_44K1, &pll));
+    TEST_ASSERT_EQUAL_UINT32(4, Wire.transactionCount());
+    TEST_ASSERT_EQUAL_UINT8(NAU_PLL1_ADDR, loggedReg(0));
+    TEST_ASSERT_EQUAL_HEX16(pll.n, loggedValue(0));
+    TEST_ASSERT_EQUAL_HEX16(pll.k >> 18, loggedValue(1));
+    TEST_ASSERT_EQUAL_HEX16((pll.k >> 9) & 0x1FF, loggedValue(2));
+    TEST_ASSERT_EQUAL_HEX16(pll.k & 0x1FF, loggedValue(3));
+    TEST_ASSERT_EQUAL_UINT8(NAU_PLL4_ADDR, loggedReg(3));
+
+    // Going back only rewrites the registers that differ
+    Wire.clearLog();
+    TEST_ASSERT_EQUAL_UINT8(0, codec.setPLL(12000000, NAU_IMCLK_48K, &pll));
+    TEST_ASSERT_TRUE(Wire.transactionCount() > 0 && Wire.transactionCount() <= 4);
+    Wire.clearLog();
+    TEST_ASSERT_EQUAL_UINT8(0, codec.setPLL(12000000, NAU_IMCLK_48K, &pll));
+    TEST_ASSERT_EQUAL_UINT32(0, Wire.transactionCount());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_write_skipped_when_shadow_matches);
+    RUN_TEST(test_ninth_bit_goes_in_the_address_byte);
+    RUN_TEST(test_update_register_keeps_other_bits);
+    RUN_TEST(test_failed_write_leaves_shadow_alone);
+    RUN_TEST(test_reset_drops_shadow_to_defaults);
+    RUN_TEST(test_optional_profile_goes_on_top_of_default);
+    RUN_TEST(test_default_profile_is_not_applied_twice);
+    RUN_TEST(test_staged_writes_commit_in_address_order);
+    RUN_TEST(test_staging_an_unchanged_value_sends_nothing);
+    RUN_TEST(test_failed_commit_stays_staged_for_retry);
+    RUN_TEST(test_transaction_inside_staging_joins_the_batch);
+    RUN_TEST(test_pll_12mhz_to_48k_family);
+    RUN_TEST(test_pll_error_matches_double_reference);
+    RUN_TEST(test_pll_without_solution);
+    RUN_TEST(test_set_pll_writes_all_four_registers_in_order);
+    return UNITY_END();
+}
@@ -0,0 +1,207 @@
+// Settings blob in NVS: version and size checks on load, and coalesced
+// writes once the live state has settled
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <unity.h>
+#include <settings_store.h>
+
+static Preferences prefs;
+static SettingsStore *store;
+static RadioSettings settings;
+static StationPresets presets;
+
+// What main.cpp would start from before anything is loaded
+static void loadDefaults()
+{
+    memset(&settings, 0, sizeof(settings));
+    memset(&presets, 0, sizeof(presets));
+    settings.pll_freq = 98500000;
+    settings.volume = 40;
+    settings.eq_gain[2] = 3;
+}
+
+void setUp()
+{
+    prefs.begin(SETTINGS_NAMESPACE, false);
+    prefs.remove("radio");
+    prefs.remove("presets");
+    store = new SettingsStore();
+    loadDefaults();
+}
+
+void tearDown()
+{
+    delete store;
+}
+
+static void storeRadio(const RadioSettings *stored)
+{
+    prefs.putBytes("radio", stored, sizeof(*stored));
+}
+
+void test_empty_flash_keeps_defaults()
+{
+    TEST_ASSERT_EQUAL_UINT8(0, store->begin(&settings, &presets));
+    TEST_ASSERT_EQUAL_UINT64(98500000, settings.pll_freq);
+    TEST_ASSERT_EQUAL_UINT8(SETTINGS_VERSION, settings.version);
+
+    // Nothing is written until something changes
+    TEST_ASSERT_EQUAL_UINT8(0, store->flush());
+    TEST_ASSERT_EQUAL_UINT32(0, store->writes());
+    TEST_ASSERT_EQUAL_UINT32(0, prefs.getBytesLength("radio"));
+}
+
+void test_current_version_blob_loads()
+{
+    RadioSettings stored = settings;
+    stored.version = SETTINGS_VERSION;
+    stored.pll_freq = 101100000;
+    stored.volume = 12;
+    storeRadio(&stored);
+
+    TEST_ASSERT_EQUAL_UINT8(SETTINGS_LOADED_RADIO, store->begin(&settings, &presets));
+    TEST_ASSERT_EQUAL_UINT64(101100000, settings.pll_freq);
+    TEST_ASSERT_EQUAL_INT8(12, settings.volume);
+}
+
+void test_other_version_blob_is_ignored()
+{
+    RadioSettings stored = settings;
+    stored.version = SETTINGS_VERSION + 1;
+    stored.pll_freq = 101100000;
+    storeRadio(&stored);
+
+    TEST_ASSERT_EQUAL_UINT8(0, store->begin(&settings, &presets));
+    TEST_ASSERT_EQUAL_UINT64(98500000, settings.pll_freq);
+    TEST_ASSERT_EQUAL_UINT8(SETTINGS_VERSION, settings.version);
+}
+
+void test_wrong_size_blob_is_ignored()
+{
+    // An older, shorter layout that happens to start the same way
+    uint8_t stored[sizeof(RadioSettings) - 6];
+    memset(stored, 0x55, sizeof(stored));
+    prefs.putBytes("radio", stored, sizeof(stored));
+
+    TEST_ASSERT_EQUAL_UINT8(0, store->begin(&settings, &presets));
+    TEST_ASSERT_EQUAL_UINT64(98500000, settings.pll_freq);
+}
+
+void test_presets_load_on_their_own()
+{
+    StationPresets stored;
+    memset(&stored, 0, sizeof(stored));
+    stored.version = PRESETS_VERSION;
+    stored.freq[3] = 94700000;
+    prefs.putBytes("presets", &stored, sizeof(stored));
+
+    TEST_ASSERT_EQUAL_UINT8(SETTINGS_LOADED_PRESETS, store->begin(&settings, &presets));
+    TEST_ASSERT_EQUAL_UINT32(94700000, presets.freq[3]);
+    TEST_ASSERT_EQUAL_UINT64(98500000, settings.pll_freq);
+}
+
+void test_unversioned_presets_are_ignored()
+{
+    // The first layout was the bare frequency array
+    uint32_t old[SETTINGS_NUM_PRESETS] = { 94700000 };
+    prefs.putBytes("presets", old, sizeof(old));
+    TEST_ASSERT_EQUAL_UINT8(0, store->begin(&settings, &presets));
+    TEST_ASSERT_EQUAL_UINT32(0, presets.freq[0]);
+    TEST_ASSERT_EQUAL_UINT8(PRESETS_VERSION, presets.version);
+
+    StationPresets stored;
+    memset(&stored, 0, sizeof(stored));
+    stored.version = PRESETS_VERSION + 1;
+    stored.freq[0] = 94700000;
+    prefs.putBytes("presets", &stored, sizeof(stored));
+    delete store;
+    store = new SettingsStore();
+    TEST_ASSERT_EQUAL_UINT8(0, store->begin(&settings, &presets));
+    TEST_ASSERT_EQUAL_UINT32(0, presets.freq[0]);
+}
+
+void test_reserved_bytes_are_cleared()
+{
+    memset(settings.reserved, 0xAA, sizeof(settings.reserved));
+    store->begin(&settings, &presets);
+    for (uint8_t i = 0; i < sizeof(settings.reserved); i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(0, settings.reserved[i]);
+    }
+}
+
+void test_changes_are_written_once_settled()
+{
+    store->begin(&settings, &presets);
+
+    // A knob spin, one change per pass
+    for (uint8_t i = 0; i < 20; i++)
+    {
+        settings.pll_freq += 100000;
+        store->update(&settings, &presets);
+        delay(50);
+    }
+    store->update(&settings, &presets);
+    TEST_ASSERT_EQUAL_UINT32(0, store->writes());
+
+    delay(SETTINGS_COMMIT_DELAY - 100);
+    store->update(&settings, &presets);
+    TEST_ASSERT_EQUAL_UINT32(0, store->writes());
+
+    delay(100);
+    store->update(&settings, &presets);
+    TEST_ASSERT_EQUAL_UINT32(1, store->writes());
+
+    RadioSettings stored;
+    TEST_ASSERT_EQUAL_UINT32(sizeof(stored), prefs.getBytes("radio", &stored, sizeof(stored)));
+    TEST_ASSERT_EQUAL_UINT64(100500000, stored.pll_freq);
+    TEST_ASSERT_EQUAL_UINT8(SETTINGS_VERSION, stored.version);
+    TEST_ASSERT_EQUAL_UINT32(0, prefs.getBytesLength("presets"));
+}
+
+void test_change_and_back_writes_nothing()
+{
+    store->begin(&settings, &presets);
+    settings.volume = 50;
+    store->update(&settings, &presets);
+    settings.volume = 40;
+    store->update(&settings, &presets);
+    delay(SETTINGS_COMMIT_DELAY);
+    store->update(&settings, &presets);
+    TEST_ASSERT_EQUAL_UINT32(0, store->writes());
+}
+
+void test_flush_writes_pending_preset_now()
+{
+    store->begin(&settings, &presets);
+    presets.freq[0] = 88100000;
+    store->update(&settings, &presets);
+    TEST_ASSERT_EQUAL_UINT8(0, store->flush());
+    TEST_ASSERT_EQUAL_UINT32(1, store->writes());
+    TEST_ASSERT_EQUAL_UINT32(sizeof(StationPresets), prefs.getBytesLength("presets"));
+    TEST_ASSERT_EQUAL_UINT32(0, prefs.getBytesLength("radio"));
+
+    // A fresh boot sees it
+    SettingsStore reboot;
+    loadDefaults();
+    TEST_ASSERT_EQUAL_UINT8(SETTINGS_LOADED_PRESETS, reboot.begin(&settings, &presets));
+    TEST_ASSERT_EQUAL_UINT32(88100000, presets.freq[0]);
+    TEST_ASSERT_EQUAL_UINT8(PRESETS_VERSION, presets.version);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_flash_keeps_defaults);
+    RUN_TEST(test_current_version_blob_loads);
+    RUN_TEST(test_other_version_blob_is_ignored);
+    RUN_TEST(test_wrong_size_blob_is_ignored);
+    RUN_TEST(test_presets_load_on_their_own);
+    RUN_TEST(test_unversioned_presets_are_ignored);
+    RUN_TEST(test_reserved_bytes_are_cleared);
+    RUN_TEST(test_changes_are_written_once_settled);
+    RUN_TEST(test_change_and_back_writes_nothing);
+    RUN_TEST(test_flush_writes_pending_preset_now);
+    return UNITY_END();
+}